@@ -0,0 +1,239 @@
+/**
+ * @file analyze_task.h
+ * @brief Корутины C++20 поверх mp3_session_run_async (хост, только заголовок)
+ *
+ * analyzeAsync() — корутина, которая на каждом чтении засыпает, а не
+ * блокирует поток: одна нить цикла событий ведёт тысячи файлов сразу.
+ * Завершения чтений хост отдаёт в ReadDispatcher::complete(), тот будит
+ * корутину нужной сессии. Если у источника только синхронный read_at,
+ * mp3_session_run_async заканчивает анализ сразу и корутина не засыпает.
+ *
+ * Слой использует только ABI mp3_lib.h. Без C++20 заголовок пуст:
+ * MP3_ANALYZE_TASK_AVAILABLE не определён.
+ *
+ *   mp3::ReadDispatcher dispatcher;
+ *   mp3::Task<mp3::AnalyzeResult> task = mp3::analyzeAsync(detector, api, dispatcher);
+ *   task.start();
+ *   mp3::pumpReads(reader, dispatcher);     // или свой цикл событий
+ *   const mp3::AnalyzeResult& r = task.result();
+ */
+
+#pragma once
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#define MP3_ANALYZE_TASK_AVAILABLE 1
+
+#include "mp3_lib.h"
+#include "async_reader.h"
+
+#include <coroutine>
+#include <exception>
+#include <unordered_map>
+#include <utility>
+
+namespace mp3 {
+
+// ============================================================================
+// Task<T>: ленивая корутина с результатом
+// ============================================================================
+
+/**
+ * Тело начинает выполняться по start() или при co_await из другой
+ * корутины; по завершении управление переходит ожидающей корутине.
+ */
+template <typename T>
+class Task {
+public:
+    struct promise_type {
+        T value{};
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept {
+            struct Final {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    const std::coroutine_handle<> next = h.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return Final{};
+        }
+
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task() = default;
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /// Запустить тело (один раз; для задач, которые никто не ждёт через co_await)
+    void start() {
+        if (handle_ && !handle_.done()) {
+            handle_.resume();
+        }
+    }
+
+    bool done() const { return !handle_ || handle_.done(); }
+
+    /// Результат завершённой задачи; исключение тела пробрасывается
+    T& result() {
+        if (handle_.promise().error) {
+            std::rethrow_exception(handle_.promise().error);
+        }
+        return handle_.promise().value;
+    }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> waiting) noexcept {
+                handle.promise().continuation = waiting;
+                return handle;
+            }
+            T await_resume() {
+                if (handle.promise().error) {
+                    std::rethrow_exception(handle.promise().error);
+                }
+                return std::move(handle.promise().value);
+            }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// ============================================================================
+// Ожидание чтений
+// ============================================================================
+
+/**
+ * @brief Корутины, ждущие чтения своих сессий
+ *
+ * Не потокобезопасен: complete() зовётся из того же потока, что ведёт
+ * корутины (цикл событий).
+ */
+class ReadDispatcher {
+public:
+    /// Отдать завершение чтения; false — эта сессия чтения не ждёт
+    bool complete(mp3_session_t* session, mp3_result_t result, size_t length) {
+        const auto it = waiters_.find(session);
+        if (it == waiters_.end()) {
+            return false;
+        }
+        Waiter waiter = it->second;
+        waiters_.erase(it);
+        *waiter.out = ReadCompletion{session, result, length};
+        waiter.handle.resume();
+        return true;
+    }
+
+    /// Сколько корутин ждут чтения
+    size_t waiting() const { return waiters_.size(); }
+
+    /// co_await wait(session) — заснуть до complete() этой сессии
+    auto wait(mp3_session_t* session) {
+        struct Awaiter {
+            ReadDispatcher* dispatcher;
+            mp3_session_t* session;
+            ReadCompletion completion{};
+
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                dispatcher->waiters_[session] = Waiter{handle, &completion};
+            }
+            ReadCompletion await_resume() noexcept { return completion; }
+        };
+        return Awaiter{this, session};
+    }
+
+private:
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        ReadCompletion* out;
+    };
+
+    std::unordered_map<mp3_session_t*, Waiter> waiters_;
+};
+
+/// Простейший цикл событий: раздавать завершения reader, пока кто-то ждёт
+inline void pumpReads(AsyncReader& reader, ReadDispatcher& dispatcher) {
+    while (dispatcher.waiting()) {
+        for (const auto& done : reader.wait()) {
+            dispatcher.complete(done.session, done.result, done.length);
+        }
+    }
+}
+
+// ============================================================================
+// Анализ
+// ============================================================================
+
+struct AnalyzeResult {
+    mp3_result_t code;
+    mp3_audio_info_t info;
+    mp3_session_stats_t stats;      ///< mp3_session_get_stats перед закрытием сессии
+};
+
+/**
+ * @brief Разобрать источник, засыпая на каждом чтении
+ *
+ * api валиден до завершения задачи. Сессия создаётся в detector и
+ * закрывается по завершении.
+ */
+inline Task<AnalyzeResult> analyzeAsync(
+    mp3_detector_t* detector,
+    mp3_host_api_t api,
+    ReadDispatcher& dispatcher,
+    mp3_analyze_options_t options = {}
+) {
+    AnalyzeResult out{};
+    mp3_session_t* session = nullptr;
+    out.code = mp3_session_init(detector, &api, &session);
+    if (out.code == MP3_OK) {
+        out.code = mp3_session_run_async(session, &options, &out.info);
+        while (out.code == MP3_ERR_PENDING) {
+            const ReadCompletion done = co_await dispatcher.wait(session);
+            out.code = mp3_session_complete(session, done.result, done.length, &out.info);
+        }
+        mp3_session_get_stats(session, &out.stats);
+    }
+    mp3_session_deinit(session);
+    co_return out;
+}
+
+} // namespace mp3
+
+#endif // __cplusplus >= 202002L
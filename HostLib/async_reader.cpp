@@ -0,0 +1,103 @@
+/**
+ * @file async_reader.cpp
+ * @brief Очередь асинхронных чтений на потоках ввода-вывода
+ */
+
+#include "async_reader.h"
+
+#include <chrono>
+
+namespace mp3 {
+
+AsyncReader::AsyncReader(unsigned threads, uint32_t latencyUs)
+    : latencyUs_(latencyUs) {
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back(&AsyncReader::workerLoop, this);
+    }
+}
+
+AsyncReader::~AsyncReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    requestReady_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void AsyncReader::submit(
+    mp3_read_at_fn readAt,
+    void* ctx,
+    uint64_t offset,
+    uint8_t* dst,
+    size_t requested,
+    mp3_session_t* session
+) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requests_.push_back(Request{readAt, ctx, offset, dst, requested, session});
+        pending_++;
+    }
+    requestReady_.notify_one();
+}
+
+std::vector<ReadCompletion> AsyncReader::wait(int timeoutMs) {
+    std::vector<ReadCompletion> ready;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    const auto hasWork = [this] { return !completions_.empty() || pending_ == 0; };
+    if (timeoutMs < 0) {
+        completionReady_.wait(lock, hasWork);
+    } else {
+        completionReady_.wait_for(lock, std::chrono::milliseconds(timeoutMs), hasWork);
+    }
+
+    ready.swap(completions_);
+    pending_ -= ready.size();
+    return ready;
+}
+
+size_t AsyncReader::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void AsyncReader::workerLoop() {
+    for (;;) {
+        Request req;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            requestReady_.wait(lock, [this] { return stop_ || !requests_.empty(); });
+            if (stop_) {
+                return;
+            }
+            req = requests_.front();
+            requests_.pop_front();
+        }
+
+        if (latencyUs_) {
+            std::this_thread::sleep_for(std::chrono::microseconds(latencyUs_));
+        }
+
+        size_t got = 0;
+        const mp3_result_t result = req.readAt(req.ctx, req.offset, req.dst, req.requested, &got);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            completions_.push_back(ReadCompletion{req.session, result, got});
+        }
+        completionReady_.notify_one();
+    }
+}
+
+} // namespace mp3
@@ -0,0 +1,94 @@
+/**
+ * @file async_reader.h
+ * @brief Очередь асинхронных чтений для mp3_session_run_async (хост)
+ *
+ * read_submit источника ставит чтение в очередь и сразу возвращается;
+ * чтения выполняют потоки ввода-вывода через синхронный read_at источника.
+ * Готовые чтения забирает wait() в потоке цикла событий — он же отдаёт их
+ * сессиям через mp3_session_complete, так что каждая сессия живёт в одном
+ * потоке. Чтений одновременно в работе — не больше числа потоков.
+ *
+ * latencyUs добавляет задержку к каждому чтению: модель SD-карты или
+ * сетевого хранилища, на которой видно, как пропускная способность
+ * растёт с глубиной очереди.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mp3 {
+
+/// Готовое чтение: передать в mp3_session_complete
+struct ReadCompletion {
+    mp3_session_t* session;
+    mp3_result_t result;
+    size_t length;
+};
+
+class AsyncReader {
+public:
+    /**
+     * @param threads Потоков ввода-вывода (глубина очереди); 0 — 1
+     * @param latencyUs Искусственная задержка каждого чтения (мкс)
+     */
+    explicit AsyncReader(unsigned threads = 4, uint32_t latencyUs = 0);
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    unsigned threads() const { return static_cast<unsigned>(workers_.size()); }
+
+    /// Поставить чтение в очередь: выполнить readAt(ctx, ...) на потоке ввода-вывода
+    void submit(
+        mp3_read_at_fn readAt,
+        void* ctx,
+        uint64_t offset,
+        uint8_t* dst,
+        size_t requested,
+        mp3_session_t* session
+    );
+
+    /**
+     * @brief Забрать готовые чтения
+     * @param timeoutMs Сколько ждать первого; -1 — пока не будет хотя бы одного
+     * @return Пусто — таймаут или в очереди ничего нет
+     */
+    std::vector<ReadCompletion> wait(int timeoutMs = -1);
+
+    /// Чтений в очереди, в работе и готовых, но не забранных
+    size_t pending() const;
+
+private:
+    struct Request {
+        mp3_read_at_fn readAt;
+        void* ctx;
+        uint64_t offset;
+        uint8_t* dst;
+        size_t requested;
+        mp3_session_t* session;
+    };
+
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    uint32_t latencyUs_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable requestReady_;
+    std::condition_variable completionReady_;
+    std::deque<Request> requests_;
+    std::vector<ReadCompletion> completions_;
+    size_t pending_ = 0;
+    bool stop_ = false;
+};
+
+} // namespace mp3
@@ -0,0 +1,260 @@
+/**
+ * @file batch_scanner.cpp
+ * @brief Многопоточный пакетный анализ файлов (work-stealing)
+ */
+
+#include "batch_scanner.h"
+#include "file_source.h"
+#include "mmap_source.h"
+
+#include <cstring>
+#include <deque>
+#include <thread>
+
+namespace mp3 {
+
+namespace {
+
+/**
+ * Итог, который зависит только от содержимого файла. Ошибки чтения,
+ * памяти, срока и т.п. пройдут при следующем пересмотре — их в индекс
+ * не кладём, иначе неизменный файл так и остался бы с ошибкой.
+ */
+bool isFileVerdict(mp3_result_t code) {
+    return code == MP3_OK || code == MP3_ERR_INVALID_FORMAT;
+}
+
+} // namespace
+
+struct BatchScanner::Worker {
+    std::thread thread;
+    std::mutex mutex;
+    std::deque<size_t> queue;
+    std::atomic<mp3_session_t*> session{nullptr};   ///< Читает cancel() из чужого потока
+    std::atomic<uint64_t> stolen{0};
+};
+
+BatchScanner::BatchScanner(mp3_detector_t* detector, unsigned jobs)
+    : detector_(detector) {
+    if (jobs == 0) {
+        jobs = std::thread::hardware_concurrency();
+    }
+    if (jobs == 0) {
+        jobs = 1;
+    }
+
+    workers_.reserve(jobs);
+    for (unsigned i = 0; i < jobs; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < jobs; ++i) {
+        workers_[i]->thread = std::thread(&BatchScanner::workerLoop, this, i);
+    }
+}
+
+BatchScanner::~BatchScanner() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        mp3_session_deinit(worker->session.load());
+    }
+}
+
+uint64_t BatchScanner::stolenCount() const {
+    uint64_t total = 0;
+    for (const auto& worker : workers_) {
+        total += worker->stolen.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::vector<ScanResult> BatchScanner::scan(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> scanLock(scanMutex_);
+
+    std::vector<ScanResult> results(paths.size());
+    if (paths.empty()) {
+        return results;
+    }
+    if (index_) {
+        keys_.assign(paths.size(), IndexKey{});
+        keyed_.assign(paths.size(), 0);
+    }
+
+    const size_t count = paths.size();
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    cancelled_.store(false);
+    paths_ = &paths;
+    results_ = &results;
+    remaining_.store(count);
+
+    // Задачи — только после paths_ и results_: воркер прошлого scan(),
+    // ещё не вышедший из цикла, может забрать их до пробуждения.
+    // Непрерывные блоки: соседние файлы одного каталога читает один воркер
+    const size_t jobCount = workers_.size();
+    for (size_t w = 0; w < jobCount; ++w) {
+        const size_t begin = count * w / jobCount;
+        const size_t end = count * (w + 1) / jobCount;
+        std::lock_guard<std::mutex> queueLock(workers_[w]->mutex);
+        for (size_t i = begin; i < end; ++i) {
+            workers_[w]->queue.push_back(i);
+        }
+    }
+
+    generation_++;
+    wake_.notify_all();
+
+    done_.wait(lock, [this] { return remaining_.load() == 0; });
+    paths_ = nullptr;
+    results_ = nullptr;
+
+    // Индекс читают воркеры, поэтому пишем в него только после них
+    if (index_) {
+        for (size_t i = 0; i < count; ++i) {
+            if (results[i].code == MP3_ERR_CANCELLED) {
+                continue;                           // не разобран — запись не трогаем
+            }
+            if (!keyed_[i]) {
+                index_->erase(keys_[i].pathHash);   // файла больше нет
+            } else if (!results[i].cached && isFileVerdict(results[i].code)) {
+                index_->put(keys_[i], results[i].code, results[i].info);
+            }
+        }
+    }
+    return results;
+}
+
+void BatchScanner::cancel() {
+    cancelled_.store(true);
+    for (auto& worker : workers_) {
+        mp3_session_cancel(worker->session.load());
+    }
+}
+
+std::vector<ScanResult> BatchScanner::update(const DirectoryChanges& changes) {
+    if (index_) {
+        for (const auto& path : changes.removed) {
+            index_->erase(DurationIndex::hashPath(path));
+        }
+    }
+    return scan(changes.modified);
+}
+
+void BatchScanner::workerLoop(unsigned index) {
+    Worker& self = *workers_[index];
+    uint64_t seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        size_t item;
+        while (popLocal(index, &item) || steal(index, &item)) {
+            analyzeOne(self, item);
+            if (remaining_.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+                done_.notify_all();
+            }
+        }
+    }
+}
+
+bool BatchScanner::popLocal(unsigned index, size_t* item) {
+    Worker& self = *workers_[index];
+    std::lock_guard<std::mutex> lock(self.mutex);
+    if (self.queue.empty()) {
+        return false;
+    }
+    *item = self.queue.back();
+    self.queue.pop_back();
+    return true;
+}
+
+bool BatchScanner::steal(unsigned thief, size_t* item) {
+    const size_t jobCount = workers_.size();
+    for (size_t k = 1; k < jobCount; ++k) {
+        Worker& victim = *workers_[(thief + k) % jobCount];
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.queue.empty()) {
+                continue;
+            }
+            *item = victim.queue.front();
+            victim.queue.pop_front();
+        }
+        workers_[thief]->stolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void BatchScanner::analyzeOne(Worker& worker, size_t item) {
+    ScanResult& r = (*results_)[item];
+    r.path = (*paths_)[item];
+    r.code = MP3_ERR_IO;
+    std::memset(&r.info, 0, sizeof(r.info));
+
+    if (cancelled_.load()) {
+        r.code = MP3_ERR_CANCELLED;
+        return;
+    }
+
+    if (index_) {
+        IndexKey& key = keys_[item];
+        if (!DurationIndex::makeKey(r.path, fingerprint_, &key)) {
+            return;
+        }
+        keyed_[item] = 1;
+        if (const IndexEntry* entry = index_->find(key)) {
+            r.code = entry->code;
+            r.info = entry->info;
+            r.cached = true;
+            return;
+        }
+    }
+
+    FileSource fileSource;
+    MmapSource mmapSource;
+    mp3_host_api_t api;
+    if (useMmap_) {
+        if (!mmapSource.open(r.path.c_str())) {
+            return;
+        }
+        api = mmapSource.hostApi();
+    } else {
+        if (!fileSource.open(r.path.c_str())) {
+            return;
+        }
+        api = fileSource.hostApi();
+    }
+    mp3_session_t* session = worker.session.load();
+    if (!session) {
+        r.code = mp3_session_init(detector_, &api, &session);
+        worker.session.store(session);
+    } else {
+        r.code = mp3_session_reset(session, &api);
+    }
+
+    // reset снимает отмену сессии: cancel(), успевший между проверкой
+    // в начале и reset, виден только по cancelled_
+    if (r.code == MP3_OK && cancelled_.load()) {
+        r.code = MP3_ERR_CANCELLED;
+    }
+    if (r.code == MP3_OK) {
+        r.code = mp3_session_run(session, &r.info);
+    }
+}
+
+} // namespace mp3
@@ -0,0 +1,135 @@
+/**
+ * @file batch_scanner.h
+ * @brief Многопоточный пакетный анализ файлов (хост)
+ *
+ * Пул потоков с work-stealing: список файлов делится на непрерывные
+ * блоки по очередям воркеров; воркер берёт задачи с хвоста своей очереди,
+ * а опустевший — крадёт с головы чужой. У каждого воркера своя сессия,
+ * которая переиспользуется через mp3_session_reset().
+ *
+ * По умолчанию файлы читаются через mp3::FileSource (pread): извлечённый
+ * носитель или укороченный файл дают MP3_ERR_IO. setUseMmap(true) —
+ * mp3::MmapSource без копирования, но с риском SIGBUS (см. mmap_source.h).
+ *
+ * С индексом (setIndex) файл, чей ключ совпал с записью, не открывается:
+ * результат берётся из индекса. Новые результаты вносятся в индекс
+ * после scan(), исчезнувшие файлы из него убираются; сохраняет индекс
+ * вызывающий. В индекс попадают только MP3_OK и MP3_ERR_INVALID_FORMAT:
+ * прочие ошибки (чтение, память, отмена, срок) не зависят от содержимого,
+ * и такой файл разбирается снова при следующем пересмотре.
+ * update() обрабатывает только журнал изменений (mp3::DirectoryWatcher),
+ * не обходя библиотеку.
+ *
+ * cancel() из другого потока обрывает scan(): идущие анализы
+ * прерываются (mp3_session_cancel), оставшиеся файлы не открываются.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+#include "directory_watcher.h"
+#include "duration_index.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mp3 {
+
+struct ScanResult {
+    std::string path;
+    mp3_result_t code;          ///< MP3_ERR_CANCELLED — scan() прерван cancel()
+    mp3_audio_info_t info;
+    bool cached;                ///< Взят из индекса, файл не разбирался
+};
+
+class BatchScanner {
+public:
+    /**
+     * @param detector Детектор (см. контракт потокобезопасности в mp3_lib.h)
+     * @param jobs Число воркеров; 0 — по числу ядер
+     */
+    explicit BatchScanner(mp3_detector_t* detector, unsigned jobs = 0);
+    ~BatchScanner();
+
+    BatchScanner(const BatchScanner&) = delete;
+    BatchScanner& operator=(const BatchScanner&) = delete;
+
+    unsigned jobs() const { return static_cast<unsigned>(workers_.size()); }
+
+    /// Сколько задач было украдено у других воркеров за всё время
+    uint64_t stolenCount() const;
+
+    /// Читать файлы через mmap (true) или pread (false, по умолчанию)
+    void setUseMmap(bool useMmap) { useMmap_ = useMmap; }
+
+    /**
+     * @brief Пропускать неизменные файлы по индексу (nullptr — без индекса)
+     * @param fingerprint Сверять ещё и отпечаток начала и конца файла
+     */
+    void setIndex(DurationIndex* index, bool fingerprint = false) {
+        index_ = index;
+        fingerprint_ = fingerprint;
+    }
+
+    /**
+     * @brief Проанализировать файлы; результаты в порядке paths
+     *
+     * Блокирует до завершения. Параллельные вызовы scan() сериализуются.
+     */
+    std::vector<ScanResult> scan(const std::vector<std::string>& paths);
+
+    /**
+     * @brief Прервать идущий scan() (из любого потока)
+     *
+     * scan() возвращается, как только воркеры бросят текущие файлы.
+     * Прерванные и не начатые файлы получают MP3_ERR_CANCELLED (у
+     * прерванных в info — оценка) и в индекс не попадают. Вызов вне
+     * scan() ничего не делает.
+     */
+    void cancel();
+
+    /**
+     * @brief Применить журнал к индексу: удалённые — убрать, изменённые — разобрать
+     *
+     * Нужен индекс (setIndex). Журнал с overflow обрабатывается так же,
+     * но пропущенные изменения он не покрывает — нужен полный scan().
+     * @return Результаты по changes.modified
+     */
+    std::vector<ScanResult> update(const DirectoryChanges& changes);
+
+private:
+    struct Worker;
+
+    void workerLoop(unsigned index);
+    bool popLocal(unsigned index, size_t* item);
+    bool steal(unsigned thief, size_t* item);
+    void analyzeOne(Worker& worker, size_t item);
+
+    mp3_detector_t* detector_;
+    bool useMmap_ = false;
+    DurationIndex* index_ = nullptr;
+    bool fingerprint_ = false;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex scanMutex_;
+
+    std::mutex stateMutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+
+    const std::vector<std::string>* paths_ = nullptr;
+    std::vector<ScanResult>* results_ = nullptr;
+    std::vector<IndexKey> keys_;            ///< Ключи файлов текущего scan() (с индексом)
+    std::vector<uint8_t> keyed_;            ///< Ключ получен (файл существует)
+    std::atomic<size_t> remaining_{0};
+    std::atomic<bool> cancelled_{false};
+};
+
+} // namespace mp3
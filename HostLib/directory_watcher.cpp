@@ -0,0 +1,206 @@
+/**
+ * @file directory_watcher.cpp
+ * @brief Журнал изменений каталога поверх inotify
+ */
+
+#include "directory_watcher.h"
+
+#include <filesystem>
+
+#if defined(__linux__)
+    #include <cerrno>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace mp3 {
+
+DirectoryWatcher::~DirectoryWatcher() {
+    stop();
+}
+
+bool DirectoryWatcher::supported() {
+#if defined(__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(__linux__)
+
+namespace {
+
+/// Файл дописан и закрыт, перемещён сюда; удалён или перемещён отсюда
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                IN_DELETE | IN_CREATE | IN_DELETE_SELF | IN_ONLYDIR;
+
+} // namespace
+
+bool DirectoryWatcher::start(const std::string& root) {
+    stop();
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        return false;
+    }
+    // Пути в журнале — как у обхода каталога: без двойных '/'
+    std::string dir = root;
+    while (dir.size() > 1 && dir.back() == '/') {
+        dir.pop_back();
+    }
+    addTree(dir, false);
+    if (dirs_.empty()) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void DirectoryWatcher::stop() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    dirs_.clear();
+}
+
+void DirectoryWatcher::addTree(const std::string& dir, bool report) {
+    const int wd = inotify_add_watch(fd_, dir.c_str(), kWatchMask);
+    if (wd < 0) {
+        // Чаще всего исчерпан max_user_watches: без пересмотра изменения потеряются
+        overflow_ = overflow_ || report || !dirs_.empty();
+        return;
+    }
+    // Тот же каталог под другим путём (bind mount, петля): остаётся первый
+    // путь, иначе журнал писал бы файлы под псевдонимом, которого нет в
+    // обходе. Старый путь исчез — каталог переехал внутри дерева.
+    std::error_code ec;
+    const auto known = dirs_.find(wd);
+    if (known != dirs_.end() &&
+        (known->second == dir || fs::equivalent(known->second, dir, ec))) {
+        return;
+    }
+    dirs_[wd] = dir;
+
+    // Каталог, появившийся при наблюдении, мог заполниться до add_watch.
+    // Ссылки на каталоги не обходятся — как и в recursive_directory_iterator
+    for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (it->is_directory(ec) && !it->is_symlink(ec)) {
+            addTree(it->path().string(), report);
+        } else if (report && it->is_regular_file(ec)) {
+            markModified(it->path().string());
+        }
+    }
+}
+
+bool DirectoryWatcher::poll(int timeoutMs) {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    pollfd pfd{fd_, POLLIN, 0};
+    const int ready = ::poll(&pfd, 1, timeoutMs);
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+    if (ready == 0) {
+        return true;
+    }
+
+    alignas(inotify_event) char buf[16 * 1024];
+    for (;;) {
+        const ssize_t len = ::read(fd_, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return true;
+            }
+            stop();
+            return false;
+        }
+        if (len == 0) {
+            return true;
+        }
+
+        for (ssize_t off = 0; off < len;) {
+            const auto* ev = reinterpret_cast<const inotify_event*>(buf + off);
+            off += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                overflow_ = true;
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                dirs_.erase(ev->wd);
+                continue;
+            }
+
+            const auto dir = dirs_.find(ev->wd);
+            if (dir == dirs_.end() || ev->len == 0) {
+                continue;
+            }
+            const std::string path = dir->second + "/" + ev->name;
+
+            if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addTree(path, true);
+                } else if (ev->mask & IN_MOVED_FROM) {
+                    // Какие файлы уехали вместе с каталогом, журнал не знает
+                    overflow_ = true;
+                }
+                continue;
+            }
+            if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                markModified(path);
+            } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                markRemoved(path);
+            }
+        }
+    }
+}
+
+#else
+
+bool DirectoryWatcher::start(const std::string& /*root*/) {
+    return false;
+}
+
+void DirectoryWatcher::stop() {
+    fd_ = -1;
+    dirs_.clear();
+}
+
+void DirectoryWatcher::addTree(const std::string& /*dir*/, bool /*report*/) {
+}
+
+bool DirectoryWatcher::poll(int /*timeoutMs*/) {
+    return false;
+}
+
+#endif
+
+void DirectoryWatcher::markModified(const std::string& path) {
+    removed_.erase(path);
+    modified_.insert(path);
+}
+
+void DirectoryWatcher::markRemoved(const std::string& path) {
+    modified_.erase(path);
+    removed_.insert(path);
+}
+
+DirectoryChanges DirectoryWatcher::takeChanges() {
+    DirectoryChanges changes;
+    changes.modified.assign(modified_.begin(), modified_.end());
+    changes.removed.assign(removed_.begin(), removed_.end());
+    changes.overflow = overflow_;
+    modified_.clear();
+    removed_.clear();
+    overflow_ = false;
+    return changes;
+}
+
+} // namespace mp3
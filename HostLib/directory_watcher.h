@@ -0,0 +1,71 @@
+/**
+ * @file directory_watcher.h
+ * @brief Журнал изменений каталога для инкрементального индекса (хост)
+ *
+ * На Linux дерево каталогов отслеживается через inotify: закрытые после
+ * записи и перемещённые внутрь файлы попадают в журнал как изменённые,
+ * удалённые и перемещённые наружу — как удалённые. Журнал схлопывает
+ * повторы, так что пересчёт индекса пропорционален числу изменённых
+ * файлов, а не размеру библиотеки. Ссылки на каталоги, как и при обходе,
+ * не отслеживаются. На других системах start() возвращает false —
+ * остаётся полный пересмотр по stat().
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mp3 {
+
+/// Накопленные изменения с прошлого takeChanges()
+struct DirectoryChanges {
+    std::vector<std::string> modified;  ///< Новые и изменённые файлы
+    std::vector<std::string> removed;   ///< Удалённые (или перемещённые наружу)
+    bool overflow = false;              ///< События потеряны — нужен полный пересмотр
+
+    bool empty() const { return modified.empty() && removed.empty() && !overflow; }
+};
+
+class DirectoryWatcher {
+public:
+    DirectoryWatcher() = default;
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    /// Умеет ли система следить за каталогами (inotify)
+    static bool supported();
+
+    /// Следить за root и всеми подкаталогами; false — не поддерживается или ошибка
+    bool start(const std::string& root);
+    void stop();
+
+    bool isWatching() const { return fd_ >= 0; }
+
+    /**
+     * @brief Дождаться событий и внести их в журнал
+     * @param timeoutMs Сколько ждать; 0 — не ждать, -1 — без ограничения
+     * @return false — ошибка чтения (наблюдение остановлено)
+     */
+    bool poll(int timeoutMs);
+
+    /// Забрать журнал; внутри он очищается
+    DirectoryChanges takeChanges();
+
+private:
+    void addTree(const std::string& dir, bool report);
+    void markModified(const std::string& path);
+    void markRemoved(const std::string& path);
+
+    int fd_ = -1;
+    std::unordered_map<int, std::string> dirs_;     ///< watch descriptor -> каталог
+    std::unordered_set<std::string> modified_;
+    std::unordered_set<std::string> removed_;
+    bool overflow_ = false;
+};
+
+} // namespace mp3
@@ -0,0 +1,319 @@
+/**
+ * @file duration_index.cpp
+ * @brief Индекс длительностей на диске
+ *
+ * Формат (little-endian):
+ *   заголовок, 24 байта:
+ *     "M3DI", u16 версия, u16 размер записи, u32 число записей,
+ *     u32 резерв, u64 FNV-1a 64 всех записей
+ *   записи по 64 байта, по возрастанию хэша пути:
+ *     u64 хэш пути, u64 размер, i64 mtime (нс), u64 отпечаток,
+ *     u32 код, u32 частота, u16 каналы, u16 бит, u32 битрейт,
+ *     u32 длительность (мс), u8 valid, u8 mode, u16 резерв, u64 размер данных
+ */
+
+#include "duration_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace mp3 {
+
+namespace {
+
+constexpr char kMagic[4] = {'M', '3', 'D', 'I'};
+constexpr uint16_t kVersion = 1;
+constexpr size_t kHeaderSize = 24;
+constexpr size_t kRecordSize = 64;
+
+/// Сколько байт начала и конца файла входит в отпечаток
+constexpr size_t kFingerprintSpan = 4096;
+
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFnvPrime = 0x100000001b3ull;
+
+uint64_t fnv1a(const uint8_t* p, size_t len, uint64_t hash = kFnvOffset) {
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ p[i]) * kFnvPrime;
+    }
+    return hash;
+}
+
+void put16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+void put64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+uint16_t get16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+uint64_t get64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+void encodeEntry(const IndexEntry& e, uint8_t* p) {
+    std::memset(p, 0, kRecordSize);
+    put64(p + 0, e.key.pathHash);
+    put64(p + 8, e.key.size);
+    put64(p + 16, static_cast<uint64_t>(e.key.mtimeNs));
+    put64(p + 24, e.key.fingerprint);
+    put32(p + 32, static_cast<uint32_t>(e.code));
+    put32(p + 36, e.info.sample_rate);
+    put16(p + 40, e.info.channels);
+    put16(p + 42, e.info.bits_per_sample);
+    put32(p + 44, e.info.bitrate);
+    put32(p + 48, e.info.duration_ms);
+    p[52] = e.info.valid;
+    p[53] = e.info.mode;
+    put64(p + 56, e.info.data_size);
+}
+
+void decodeEntry(const uint8_t* p, IndexEntry* e) {
+    std::memset(e, 0, sizeof(*e));
+    e->key.pathHash = get64(p + 0);
+    e->key.size = get64(p + 8);
+    e->key.mtimeNs = static_cast<int64_t>(get64(p + 16));
+    e->key.fingerprint = get64(p + 24);
+    e->code = static_cast<mp3_result_t>(get32(p + 32));
+    e->info.sample_rate = get32(p + 36);
+    e->info.channels = get16(p + 40);
+    e->info.bits_per_sample = get16(p + 42);
+    e->info.bitrate = get32(p + 44);
+    e->info.duration_ms = get32(p + 48);
+    e->info.valid = p[52];
+    e->info.mode = p[53];
+    e->info.data_size = get64(p + 56);
+}
+
+int64_t mtimeNs(const struct stat& st) {
+#if defined(__APPLE__)
+    const struct timespec& ts = st.st_mtimespec;
+#else
+    const struct timespec& ts = st.st_mtim;
+#endif
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/// Прочитать до len байт с offset; false — ошибка чтения
+bool preadAll(int fd, uint8_t* dst, size_t len, uint64_t offset, size_t* got) {
+    *got = 0;
+    while (*got < len) {
+        const ssize_t rd = pread(fd, dst + *got, len - *got,
+                                 static_cast<off_t>(offset + *got));
+        if (rd < 0) {
+            return false;
+        }
+        if (rd == 0) {
+            break;
+        }
+        *got += static_cast<size_t>(rd);
+    }
+    return true;
+}
+
+} // namespace
+
+uint64_t DurationIndex::hashPath(const std::string& path) {
+    return fnv1a(reinterpret_cast<const uint8_t*>(path.data()), path.size());
+}
+
+bool DurationIndex::makeKey(const std::string& path, bool fingerprint, IndexKey* out) {
+    std::memset(out, 0, sizeof(*out));
+    out->pathHash = hashPath(path);
+
+    if (!fingerprint) {
+        struct stat st{};
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            return false;
+        }
+        out->size = static_cast<uint64_t>(st.st_size);
+        out->mtimeNs = mtimeNs(st);
+        return true;
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st{};
+    bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (ok) {
+        out->size = static_cast<uint64_t>(st.st_size);
+        out->mtimeNs = mtimeNs(st);
+
+        // Начало и конец: там теги и заголовки, которые правят редакторы
+        uint8_t buf[kFingerprintSpan];
+        size_t got = 0;
+        uint64_t hash = kFnvOffset;
+        ok = preadAll(fd, buf, sizeof(buf), 0, &got);
+        hash = fnv1a(buf, got, hash);
+        if (ok && out->size > kFingerprintSpan) {
+            const uint64_t tail = std::max<uint64_t>(out->size - kFingerprintSpan, kFingerprintSpan);
+            ok = preadAll(fd, buf, sizeof(buf), tail, &got);
+            hash = fnv1a(buf, got, hash);
+        }
+        out->fingerprint = hash ? hash : 1;
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool DurationIndex::load(const std::string& file) {
+    entries_.clear();
+
+    FILE* f = fopen(file.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+
+    uint8_t header[kHeaderSize];
+    bool ok = fread(header, 1, sizeof(header), f) == sizeof(header) &&
+              std::memcmp(header, kMagic, sizeof(kMagic)) == 0 &&
+              get16(header + 4) == kVersion &&
+              get16(header + 6) == kRecordSize;
+
+    // Число записей из заголовка сверяется с размером файла до выделения:
+    // испорченный счётчик иначе запросил бы до 4G записей
+    struct stat st;
+    const uint64_t count = get32(header + 8);
+    ok = ok && fstat(fileno(f), &st) == 0 &&
+         static_cast<uint64_t>(st.st_size) == kHeaderSize + count * kRecordSize;
+
+    std::vector<uint8_t> records;
+    if (ok) {
+        records.resize(static_cast<size_t>(count) * kRecordSize);
+        ok = fread(records.data(), 1, records.size(), f) == records.size() &&
+             fnv1a(records.data(), records.size()) == get64(header + 16);
+    }
+    fclose(f);
+    if (!ok) {
+        return false;
+    }
+
+    entries_.reserve(records.size() / kRecordSize);
+    for (size_t off = 0; off < records.size(); off += kRecordSize) {
+        IndexEntry e;
+        decodeEntry(records.data() + off, &e);
+        entries_[e.key.pathHash] = e;
+    }
+    return true;
+}
+
+bool DurationIndex::save(const std::string& file) const {
+    std::vector<const IndexEntry*> sorted;
+    sorted.reserve(entries_.size());
+    for (const auto& item : entries_) {
+        sorted.push_back(&item.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const IndexEntry* a, const IndexEntry* b) {
+        return a->key.pathHash < b->key.pathHash;
+    });
+
+    std::vector<uint8_t> records(sorted.size() * kRecordSize);
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        encodeEntry(*sorted[i], records.data() + i * kRecordSize);
+    }
+
+    uint8_t header[kHeaderSize] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    put16(header + 4, kVersion);
+    put16(header + 6, kRecordSize);
+    put32(header + 8, static_cast<uint32_t>(sorted.size()));
+    put64(header + 16, fnv1a(records.data(), records.size()));
+
+    const std::string tmp = file + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(header, 1, sizeof(header), f) == sizeof(header) &&
+              fwrite(records.data(), 1, records.size(), f) == records.size() &&
+              fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // Без fsync каталога rename может не пережить сбой питания
+    const size_t slash = file.find_last_of('/');
+    const std::string dir = (slash == std::string::npos) ? "." : file.substr(0, slash + 1);
+    const int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+
+const IndexEntry* DurationIndex::find(const IndexKey& key) const {
+    const auto it = entries_.find(key.pathHash);
+    if (it == entries_.end()) {
+        return nullptr;
+    }
+    const IndexKey& stored = it->second.key;
+    if (stored.size != key.size || stored.mtimeNs != key.mtimeNs ||
+        stored.fingerprint != key.fingerprint) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+size_t DurationIndex::retain(const std::vector<std::string>& paths) {
+    std::unordered_set<uint64_t> keep;
+    keep.reserve(paths.size());
+    for (const auto& path : paths) {
+        keep.insert(hashPath(path));
+    }
+
+    size_t removed = 0;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (keep.count(it->first)) {
+            ++it;
+        } else {
+            it = entries_.erase(it);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+void DurationIndex::put(const IndexKey& key, mp3_result_t code, const mp3_audio_info_t& info) {
+    IndexEntry& e = entries_[key.pathHash];
+    e.key = key;
+    e.code = code;
+    e.info = info;
+}
+
+} // namespace mp3
@@ -0,0 +1,82 @@
+/**
+ * @file duration_index.h
+ * @brief Индекс длительностей на диске (хост)
+ *
+ * Хранит mp3_audio_info_t и код результата по каждому файлу. Ключ —
+ * хэш пути, размер, mtime и (опционально) отпечаток начала и конца
+ * файла. Если ключ совпал, файл считается неизменным и повторно не
+ * разбирается: тёплый пересмотр библиотеки стоит одного stat() на файл.
+ *
+ * Формат файла — заголовок и записи фиксированного размера,
+ * little-endian, с контрольной суммой; битый или чужой версии файл
+ * читается как пустой индекс.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mp3 {
+
+/// Что считается «тем же файлом»
+struct IndexKey {
+    uint64_t pathHash;          ///< FNV-1a 64 пути
+    uint64_t size;
+    int64_t mtimeNs;
+    uint64_t fingerprint;       ///< Хэш первых и последних 4 KiB; 0 — не считался
+};
+
+struct IndexEntry {
+    IndexKey key;
+    mp3_result_t code;
+    mp3_audio_info_t info;
+};
+
+class DurationIndex {
+public:
+    /// FNV-1a 64 пути как есть (без нормализации)
+    static uint64_t hashPath(const std::string& path);
+
+    /**
+     * @brief Ключ файла: stat() и, если fingerprint, чтение 8 KiB
+     * @return false — файла нет или он не читается
+     */
+    static bool makeKey(const std::string& path, bool fingerprint, IndexKey* out);
+
+    /**
+     * @brief Прочитать индекс
+     * @return false — файла нет или он битый: размер не сходится с числом
+     *         записей в заголовке, контрольная сумма не совпала (индекс пуст)
+     */
+    bool load(const std::string& file);
+
+    /**
+     * @brief Записать атомарно: временный файл рядом, fsync, rename поверх
+     * file и fsync каталога. Читатель видит старый индекс или новый целиком.
+     */
+    bool save(const std::string& file) const;
+
+    /// Запись, если файл с этим ключом не менялся; иначе nullptr
+    const IndexEntry* find(const IndexKey& key) const;
+
+    void put(const IndexKey& key, mp3_result_t code, const mp3_audio_info_t& info);
+
+    /// Убрать запись файла (удалён); false — её не было
+    bool erase(uint64_t pathHash) { return entries_.erase(pathHash) != 0; }
+
+    /// Оставить только записи этих путей (после полного обхода каталога)
+    size_t retain(const std::vector<std::string>& paths);
+
+    size_t size() const { return entries_.size(); }
+    void clear() { entries_.clear(); }
+
+private:
+    std::unordered_map<uint64_t, IndexEntry> entries_;  ///< По pathHash
+};
+
+} // namespace mp3
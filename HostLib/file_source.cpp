@@ -0,0 +1,105 @@
+/**
+ * @file file_source.cpp
+ * @brief Источник данных поверх POSIX-файла (pread)
+ */
+
+#include "file_source.h"
+#include "async_reader.h"
+#include "host_clock.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mp3 {
+
+FileSource::~FileSource() {
+    close();
+}
+
+bool FileSource::open(const char* path) {
+    close();
+
+    fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd_, &st) != 0) {
+        close();
+        return false;
+    }
+
+    size_ = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+void FileSource::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    size_ = 0;
+}
+
+mp3_host_api_t FileSource::hostApi() {
+    mp3_host_api_t api{};
+    api.user_ctx    = this;
+    api.source_size = size_;
+    api.read_at     = readAt;
+    api.clock_us    = steadyClockUs;
+    api.read_submit = reader_ ? submitRead : nullptr;
+    return api;
+}
+
+mp3_result_t FileSource::readAt(
+    void* user_ctx,
+    uint64_t offset,
+    uint8_t* dst,
+    size_t requested,
+    size_t* out_read
+) {
+    auto* self = static_cast<FileSource*>(user_ctx);
+    if (!self || self->fd_ < 0 || !dst || !out_read) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    size_t done = 0;
+    while (done < requested) {
+        const ssize_t rd = pread(self->fd_, dst + done, requested - done,
+                                 static_cast<off_t>(offset + done));
+        if (rd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return MP3_ERR_IO;
+        }
+        if (rd == 0) {
+            break;
+        }
+        done += static_cast<size_t>(rd);
+    }
+
+    *out_read = done;
+    return MP3_OK;
+}
+
+mp3_result_t FileSource::submitRead(
+    void* user_ctx,
+    uint64_t offset,
+    uint8_t* dst,
+    size_t requested,
+    mp3_session_t* session
+) {
+    auto* self = static_cast<FileSource*>(user_ctx);
+    if (!self || self->fd_ < 0 || !self->reader_ || !dst) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    self->reader_->submit(readAt, self, offset, dst, requested, session);
+    return MP3_OK;
+}
+
+} // namespace mp3
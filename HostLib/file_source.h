@@ -0,0 +1,62 @@
+/**
+ * @file file_source.h
+ * @brief Источник данных для mp3_host_api_t поверх POSIX-файла (pread)
+ *
+ * pread не трогает общую позицию файла, поэтому read_at не требует
+ * блокировок и безопасен при вызове из разных потоков.
+ * С setReader() источник получает и read_submit: чтения уходят
+ * в очередь mp3::AsyncReader.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+namespace mp3 {
+
+class AsyncReader;
+
+class FileSource {
+public:
+    FileSource() = default;
+    ~FileSource();
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    /// Открыть файл на чтение; false при ошибке
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const { return fd_ >= 0; }
+    uint64_t size() const { return size_; }
+
+    /// Очередь для асинхронных чтений (nullptr — только read_at)
+    void setReader(AsyncReader* reader) { reader_ = reader; }
+
+    /// Набор ручек хоста; валиден, пока источник открыт
+    mp3_host_api_t hostApi();
+
+private:
+    static mp3_result_t readAt(
+        void* user_ctx,
+        uint64_t offset,
+        uint8_t* dst,
+        size_t requested,
+        size_t* out_read
+    );
+
+    static mp3_result_t submitRead(
+        void* user_ctx,
+        uint64_t offset,
+        uint8_t* dst,
+        size_t requested,
+        mp3_session_t* session
+    );
+
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    AsyncReader* reader_ = nullptr;
+};
+
+} // namespace mp3
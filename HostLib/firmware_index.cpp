@@ -0,0 +1,85 @@
+/**
+ * @file firmware_index.cpp
+ * @brief Построение бинарного индекса для прошивки
+ */
+
+#include "firmware_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+namespace mp3 {
+
+void FirmwareIndexWriter::add(const std::string& relativePath, uint64_t fileSize,
+                              mp3_result_t code, const mp3_audio_info_t& info) {
+    mp3_index_entry_t e{};
+    e.path_hash = mp3_index_hash_path(relativePath.c_str());
+    e.file_size = fileSize;
+    e.duration_ms = info.duration_ms;
+    e.bitrate = info.bitrate;
+    e.sample_rate = info.sample_rate;
+    e.channels = static_cast<uint8_t>(info.channels);
+    e.mode = info.mode;
+    e.valid = info.valid;
+    e.code = static_cast<uint8_t>(code);
+    entries_.push_back(e);
+}
+
+bool FirmwareIndexWriter::write(const std::string& file, size_t* outDropped) const {
+    std::vector<mp3_index_entry_t> sorted = entries_;
+    std::sort(sorted.begin(), sorted.end(),
+              [](const mp3_index_entry_t& a, const mp3_index_entry_t& b) {
+                  return a.path_hash < b.path_hash;
+              });
+
+    // Коллизии хэша: выбрасываем всю группу
+    std::vector<mp3_index_entry_t> unique;
+    unique.reserve(sorted.size());
+    for (size_t i = 0; i < sorted.size();) {
+        size_t j = i + 1;
+        while (j < sorted.size() && sorted[j].path_hash == sorted[i].path_hash) {
+            ++j;
+        }
+        if (j == i + 1) {
+            unique.push_back(sorted[i]);
+        }
+        i = j;
+    }
+    if (outDropped) {
+        *outDropped = sorted.size() - unique.size();
+    }
+
+    mp3_index_header_t header{};
+    std::memcpy(header.magic, MP3_INDEX_MAGIC, sizeof(header.magic));
+    header.version = MP3_INDEX_VERSION;
+    header.entry_size = MP3_INDEX_ENTRY_SIZE;
+    header.entry_count = static_cast<uint32_t>(unique.size());
+    header.entries_offset = MP3_INDEX_ENTRIES_OFFSET;
+    header.created_unix = static_cast<uint64_t>(std::time(nullptr));
+
+    std::vector<uint8_t> image(MP3_INDEX_ENTRIES_OFFSET + unique.size() * MP3_INDEX_ENTRY_SIZE, 0);
+    mp3_index_encode_header(&header, image.data());
+    for (size_t i = 0; i < unique.size(); ++i) {
+        mp3_index_encode_entry(&unique[i],
+                               image.data() + MP3_INDEX_ENTRIES_OFFSET + i * MP3_INDEX_ENTRY_SIZE);
+    }
+
+    const std::string tmp = file + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), f) == image.size() &&
+              fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace mp3
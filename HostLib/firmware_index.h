@@ -0,0 +1,44 @@
+/**
+ * @file firmware_index.h
+ * @brief Построение бинарного индекса для прошивки (формат — mp3_index.h)
+ *
+ * Хост собирает результаты разбора по каталогу и пишет индекс, который
+ * прошивка ищет по хэшу пути без разбора файлов. Пути задаются от корня
+ * библиотеки, как их увидит прошивка.
+ */
+
+#pragma once
+
+#include "mp3_index.h"
+
+#include <string>
+#include <vector>
+
+namespace mp3 {
+
+class FirmwareIndexWriter {
+public:
+    /**
+     * @param relativePath Путь от корня библиотеки с '/' (без ведущего '/')
+     * @param fileSize Размер файла: по нему прошивка узнаёт устаревшую запись
+     */
+    void add(const std::string& relativePath, uint64_t fileSize,
+             mp3_result_t code, const mp3_audio_info_t& info);
+
+    size_t size() const { return entries_.size(); }
+    void clear() { entries_.clear(); }
+
+    /**
+     * @brief Записать индекс: во временный файл рядом и переименовать поверх file
+     *
+     * Записи с одинаковым хэшем пути отбрасываются все: прошивка
+     * не отличила бы их друг от друга.
+     * @param outDropped Сколько записей отброшено (может быть nullptr)
+     */
+    bool write(const std::string& file, size_t* outDropped = nullptr) const;
+
+private:
+    std::vector<mp3_index_entry_t> entries_;
+};
+
+} // namespace mp3
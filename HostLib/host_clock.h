@@ -0,0 +1,20 @@
+/**
+ * @file host_clock.h
+ * @brief Часы хоста для mp3_host_api_t::clock_us (steady_clock)
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+#include <chrono>
+
+namespace mp3 {
+
+/// Монотонные микросекунды; подходит как mp3_clock_us_fn
+inline uint64_t steadyClockUs(void* /*user_ctx*/) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace mp3
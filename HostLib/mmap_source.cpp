@@ -0,0 +1,113 @@
+/**
+ * @file mmap_source.cpp
+ * @brief Источник данных поверх mmap
+ */
+
+#include "mmap_source.h"
+#include "host_clock.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mp3 {
+
+MmapSource::~MmapSource() {
+    close();
+}
+
+bool MmapSource::open(const char* path) {
+    close();
+
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = static_cast<uint64_t>(st.st_size);
+    if (size_ > 0) {
+        void* map = mmap(nullptr, static_cast<size_t>(size_), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(map);
+    }
+
+    // Отображение живёт и без дескриптора
+    ::close(fd);
+    open_ = true;
+    return true;
+}
+
+void MmapSource::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+mp3_host_api_t MmapSource::hostApi() {
+    mp3_host_api_t api{};
+    api.user_ctx    = this;
+    api.source_size = size_;
+    api.read_at     = readAt;
+    api.clock_us    = steadyClockUs;
+    api.borrow_at   = borrowAt;
+    return api;
+}
+
+mp3_result_t MmapSource::readAt(
+    void* user_ctx,
+    uint64_t offset,
+    uint8_t* dst,
+    size_t requested,
+    size_t* out_read
+) {
+    const uint8_t* src = nullptr;
+    size_t len = 0;
+    const mp3_result_t result = borrowAt(user_ctx, offset, requested, &src, &len);
+    if (result != MP3_OK) {
+        return result;
+    }
+    if (!dst || !out_read) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    if (len) {
+        std::memcpy(dst, src, len);
+    }
+    *out_read = len;
+    return MP3_OK;
+}
+
+mp3_result_t MmapSource::borrowAt(
+    void* user_ctx,
+    uint64_t offset,
+    size_t requested,
+    const uint8_t** out_data,
+    size_t* out_len
+) {
+    auto* self = static_cast<MmapSource*>(user_ctx);
+    if (!self || !self->open_ || !out_data || !out_len) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    const uint64_t left = (offset < self->size_) ? self->size_ - offset : 0;
+    *out_data = self->data_ ? self->data_ + (offset < self->size_ ? offset : self->size_) : nullptr;
+    *out_len = (requested < left) ? requested : static_cast<size_t>(left);
+    return MP3_OK;
+}
+
+} // namespace mp3
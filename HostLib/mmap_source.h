@@ -0,0 +1,63 @@
+/**
+ * @file mmap_source.h
+ * @brief Источник данных для mp3_host_api_t поверх mmap (без копирования)
+ *
+ * Файл отображается в память целиком; borrow_at отдаёт парсеру указатели
+ * прямо в отображение, так что разбор заголовков не копирует ни байта.
+ * read_at оставлен для парсеров без поддержки borrow.
+ *
+ * Риск: ошибка чтения отображения — это не код возврата, а SIGBUS.
+ * Если файл укоротили после open() или носитель (SD-карту, USB) извлекли
+ * во время разбора, процесс падает, а не получает MP3_ERR_IO. Поэтому
+ * mmap — только по явному выбору (BatchScanner::setUseMmap, --mmap) и
+ * для файлов, которые не меняются под ногами; по умолчанию — FileSource.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+namespace mp3 {
+
+class MmapSource {
+public:
+    MmapSource() = default;
+    ~MmapSource();
+
+    MmapSource(const MmapSource&) = delete;
+    MmapSource& operator=(const MmapSource&) = delete;
+
+    /// Открыть и отобразить файл; false при ошибке
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const { return open_; }
+    uint64_t size() const { return size_; }
+    const uint8_t* data() const { return data_; }
+
+    /// Набор ручек хоста (read_at + borrow_at); валиден, пока источник открыт
+    mp3_host_api_t hostApi();
+
+private:
+    static mp3_result_t readAt(
+        void* user_ctx,
+        uint64_t offset,
+        uint8_t* dst,
+        size_t requested,
+        size_t* out_read
+    );
+
+    static mp3_result_t borrowAt(
+        void* user_ctx,
+        uint64_t offset,
+        size_t requested,
+        const uint8_t** out_data,
+        size_t* out_len
+    );
+
+    const uint8_t* data_ = nullptr;
+    uint64_t size_ = 0;
+    bool open_ = false;
+};
+
+} // namespace mp3
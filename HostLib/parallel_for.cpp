@@ -0,0 +1,111 @@
+/**
+ * @file parallel_for.cpp
+ * @brief Пул потоков для mp3_host_api_t::parallel_for
+ */
+
+#include "parallel_for.h"
+
+namespace mp3 {
+
+ParallelFor::ParallelFor(unsigned threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    workers_.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers_.emplace_back(&ParallelFor::workerLoop, this);
+    }
+}
+
+ParallelFor::~ParallelFor() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ParallelFor::run(uint32_t count, mp3_task_fn task, void* taskCtx) {
+    if (count == 0 || !task) {
+        return;
+    }
+
+    // Одна задача или нет потоков — будить некого
+    if (count == 1 || workers_.empty()) {
+        for (uint32_t i = 0; i < count; ++i) {
+            task(taskCtx, i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex_);
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        task_ = task;
+        taskCtx_ = taskCtx;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        busy_ = static_cast<unsigned>(workers_.size());
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+}
+
+void ParallelFor::attach(mp3_host_api_t* api) {
+    api->parallel_for = hostParallelFor;
+    api->parallel_ctx = this;
+}
+
+void ParallelFor::hostParallelFor(
+    void* parallel_ctx,
+    uint32_t count,
+    mp3_task_fn task,
+    void* task_ctx
+) {
+    static_cast<ParallelFor*>(parallel_ctx)->run(count, task, task_ctx);
+}
+
+void ParallelFor::workerLoop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        if (--busy_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+void ParallelFor::drain() {
+    for (uint32_t i = next_.fetch_add(1, std::memory_order_relaxed); i < count_;
+         i = next_.fetch_add(1, std::memory_order_relaxed)) {
+        task_(taskCtx_, i);
+    }
+}
+
+} // namespace mp3
@@ -0,0 +1,75 @@
+/**
+ * @file parallel_for.h
+ * @brief Пул потоков для mp3_host_api_t::parallel_for (хост)
+ *
+ * Фиксированный набор потоков; вызывающий поток тоже берёт задачи,
+ * номера раздаются общим атомарным счётчиком. Один пул можно отдать
+ * нескольким сессиям: параллельные run() выполняются по очереди.
+ *
+ * Источник сессии должен быть потокобезопасен — mp3::FileSource (pread)
+ * и mp3::MmapSource подходят.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mp3 {
+
+class ParallelFor {
+public:
+    /**
+     * @param threads Сколько потоков считают задачи, включая вызывающий;
+     *                0 — по числу ядер, 1 — всё на вызывающем потоке
+     */
+    explicit ParallelFor(unsigned threads = 0);
+    ~ParallelFor();
+
+    ParallelFor(const ParallelFor&) = delete;
+    ParallelFor& operator=(const ParallelFor&) = delete;
+
+    unsigned threads() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+    /// Выполнить task(taskCtx, 0..count-1) и дождаться всех
+    void run(uint32_t count, mp3_task_fn task, void* taskCtx);
+
+    /// Заполнить parallel_for / parallel_ctx в наборе ручек хоста
+    void attach(mp3_host_api_t* api);
+
+    /// mp3_parallel_for_fn поверх run(); parallel_ctx — ParallelFor*
+    static void hostParallelFor(
+        void* parallel_ctx,
+        uint32_t count,
+        mp3_task_fn task,
+        void* task_ctx
+    );
+
+private:
+    void workerLoop();
+    void drain();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex runMutex_;
+
+    std::mutex stateMutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_ = 0;
+    unsigned busy_ = 0;
+    bool stop_ = false;
+
+    mp3_task_fn task_ = nullptr;
+    void* taskCtx_ = nullptr;
+    uint32_t count_ = 0;
+    std::atomic<uint32_t> next_{0};
+};
+
+} // namespace mp3
@@ -0,0 +1,790 @@
+/**
+ * @file main.cpp
+ * @brief Бенчмарк mp3DurationDetector
+ *
+ * Прогоняет каждый .mp3 из папки N раз через mp3_analyze() и считает:
+ *  - задержку анализа (p50 / p99 / max);
+ *  - пропускную способность: по реально прочитанным байтам (mb_per_s)
+ *    и по полному размеру файла (effective_mb_per_s);
+ *  - обращения к хосту и счётчики разбора из mp3_session_get_stats();
+ *  - число аллокаций на прогон (все аллокации идут через ручки хоста);
+ *  - пропускную способность поиска sync-слова каждой доступной реализацией
+ *    (scalar / SSE2 / AVX2 / NEON) и её совпадение со scalar-эталоном.
+ * --parallel N отдаёт сессиям пул из N потоков (parallel_for): точный
+ * подсчёт больших файлов идёт участками.
+ * --step B ведёт анализ через mp3_session_step с бюджетом B байт и пишет
+ * число шагов и самый долгий шаг (граница задержки для кооперативной задачи).
+ * Через progress каждого прогона замеряется, когда пришло первое число
+ * (оценка или итог), и сколько было оценок до итога.
+ * --async D прогоняет папку асинхронно (mp3_session_run_async): один поток,
+ * до D сессий с чтением в полёте, чтения — на mp3::AsyncReader с задержкой
+ * --latency мкс; сравнивается с глубиной 1 и с результатами синхронного прогона.
+ * В сборке C++20 добавляется прогон корутинами (analyze_task.h): все файлы
+ * круга в полёте сразу, чтения — на тех же D потоках.
+ * Результат — JSON (stdout или --out), краткая сводка — в stderr.
+ *
+ * Использование:
+ *   ./Mp3Bench [--iterations N] [--mmap] [--memory pool|arena|heap]
+ *              [--mode xing|fast|exact] [--parallel N]
+ *              [--step BYTES] [--async DEPTH] [--latency US]
+ *              [--out result.json] [dir]
+ */
+
+#include "mp3_lib.h"
+#include "mp3_native.h"
+#include "analyze_task.h"
+#include "async_reader.h"
+#include "file_source.h"
+#include "mmap_source.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// ============================================================================
+// Аллокатор хоста со счётчиком
+// ============================================================================
+
+static uint64_t g_allocations = 0;
+
+static void* countingAlloc(void* /*user_ctx*/, size_t size) {
+    g_allocations++;
+    return std::malloc(size);
+}
+
+static void countingFree(void* /*user_ctx*/, void* ptr) {
+    std::free(ptr);
+}
+
+// ============================================================================
+// Замеры по одному файлу
+// ============================================================================
+
+struct FileBench {
+    std::string name;
+    uint64_t size;
+    mp3_result_t code;
+    mp3_audio_info_t info;
+    std::vector<double> latenciesUs;
+    double totalUs;
+    mp3_session_stats_t stats;      ///< Последнего прогона
+    mp3_duration_estimate_t estimate;
+    double allocsPerRun;
+    double maxStepUs;               ///< Самый долгий mp3_session_step (--step)
+    std::vector<double> firstResultUs;  ///< От начала прогона до первого вызова progress
+    uint32_t estimates;             ///< Оценок до итога (последний прогон)
+};
+
+/// Первый вызов progress прогона и число оценок
+struct ProgressProbe {
+    std::chrono::steady_clock::time_point started;
+    double firstUs;
+    uint32_t estimates;
+};
+
+static void onProgress(void* ctx, const mp3_audio_info_t* /*info*/, uint8_t kind) {
+    auto* probe = static_cast<ProgressProbe*>(ctx);
+    if (probe->firstUs < 0.0) {
+        probe->firstUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - probe->started).count();
+    }
+    if (kind == MP3_PROGRESS_ESTIMATE) {
+        probe->estimates++;
+    }
+}
+
+/// Перцентиль методом nearest-rank по отсортированному вектору
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    rank = std::max<size_t>(rank, 1);
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+static const char* modeName(uint8_t mode) {
+    switch (mode) {
+        case MP3_MODE_TRUST_XING:    return "xing";
+        case MP3_MODE_FAST_ESTIMATE: return "fast";
+        case MP3_MODE_EXACT_SCAN:    return "exact";
+        case MP3_MODE_CBR_VERIFIED:  return "cbr";
+        default:                     return "?";
+    }
+}
+
+static bool benchFile(
+    mp3_detector_t* detector,
+    const fs::path& filePath,
+    unsigned iterations,
+    bool useMmap,
+    const mp3_analyze_options_t& runOptions,
+    mp3::ParallelFor* pool,
+    uint32_t stepBytes,
+    FileBench& out
+) {
+    out = FileBench{};
+    out.name = filePath.filename().string();
+    out.code = MP3_ERR_IO;
+
+    mp3::FileSource file;
+    mp3::MmapSource mapped;
+    mp3_host_api_t api{};
+    if (useMmap) {
+        if (!mapped.open(filePath.c_str())) {
+            return false;
+        }
+        api = mapped.hostApi();
+    } else {
+        if (!file.open(filePath.c_str())) {
+            return false;
+        }
+        api = file.hostApi();
+    }
+    out.size = api.source_size;
+    if (pool) {
+        pool->attach(&api);
+    }
+    api.alloc = countingAlloc;
+    api.free = countingFree;
+    out.latenciesUs.reserve(iterations);
+    out.firstResultUs.reserve(iterations);
+    const uint64_t allocationsBefore = g_allocations;
+
+    ProgressProbe probe{};
+    mp3_analyze_options_t options = runOptions;
+    options.progress = onProgress;
+    options.progress_ctx = &probe;
+
+    // Тот же путь, что mp3_analyze(), но с доступом к статистике сессии
+    for (unsigned i = 0; i < iterations; ++i) {
+        const auto started = std::chrono::steady_clock::now();
+        probe = ProgressProbe{started, -1.0, 0};
+        mp3_session_t* session = nullptr;
+        out.code = mp3_session_init(detector, &api, &session);
+        if (out.code == MP3_OK && stepBytes) {
+            // Шаги с бюджетом: задержка каждого — как её увидит планировщик
+            out.code = mp3_session_begin(session, &options);
+            uint8_t done = out.code != MP3_OK;
+            while (!done) {
+                const auto stepStarted = std::chrono::steady_clock::now();
+                out.code = mp3_session_step(session, stepBytes, &done, &out.info);
+                out.maxStepUs = std::max(out.maxStepUs, std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - stepStarted).count());
+            }
+        } else if (out.code == MP3_OK) {
+            out.code = mp3_session_run_ex(session, &options, &out.info);
+        }
+        const double us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - started).count();
+
+        if (session) {
+            mp3_session_get_stats(session, &out.stats);
+            mp3_session_get_estimate(session, &out.estimate);
+            mp3_session_deinit(session);
+        }
+        out.latenciesUs.push_back(us);
+        out.totalUs += us;
+        if (probe.firstUs >= 0.0) {
+            out.firstResultUs.push_back(probe.firstUs);
+        }
+        out.estimates = probe.estimates;
+    }
+
+    out.allocsPerRun = static_cast<double>(g_allocations - allocationsBefore) / iterations;
+    std::sort(out.latenciesUs.begin(), out.latenciesUs.end());
+    std::sort(out.firstResultUs.begin(), out.firstResultUs.end());
+    return true;
+}
+
+static double mbPerSec(uint64_t bytes, unsigned iterations, double totalUs) {
+    if (totalUs <= 0.0) {
+        return 0.0;
+    }
+    return static_cast<double>(bytes) * iterations / totalUs;   // байт/мкс == MB/s
+}
+
+// ============================================================================
+// Асинхронный анализ: глубина очереди на одном потоке
+// ============================================================================
+
+struct AsyncBench {
+    bool coroutine;                 ///< Через analyzeAsync (C++20)
+    unsigned depth;
+    uint32_t latencyUs;
+    size_t runs;                    ///< Файлов разобрано за все круги
+    uint64_t reads;                 ///< Чтений через read_submit
+    double totalUs;
+    size_t mismatches;              ///< Расхождений с синхронным прогоном
+};
+
+/**
+ * rounds раз разобрать все файлы, держа до depth сессий с чтением в полёте.
+ * Цикл событий однопоточный: сессии запускает и продолжает только он.
+ */
+static AsyncBench benchAsync(
+    const std::vector<fs::path>& paths,
+    const std::vector<FileBench>& reference,
+    const mp3_analyze_options_t& options,
+    unsigned depth,
+    uint32_t latencyUs,
+    unsigned rounds
+) {
+    AsyncBench bench{false, depth, latencyUs, 0, 0, 0.0, 0};
+
+    mp3_detector_config_t config{};
+    config.session_pool_capacity = depth;
+    mp3_detector_t* detector = mp3_detector_create_ex(&config);
+    mp3::AsyncReader reader(depth, latencyUs);
+
+    struct Slot {
+        mp3::FileSource file;
+        mp3_session_t* session = nullptr;
+        size_t index = 0;
+    };
+    std::vector<Slot> slots(depth);
+    std::unordered_map<mp3_session_t*, Slot*> inFlight;
+    const size_t total = paths.size() * rounds;
+    size_t next = 0;
+
+    const auto finish = [&](Slot& slot, mp3_result_t code, const mp3_audio_info_t& info) {
+        const FileBench& expected = reference[slot.index];
+        if (code != expected.code || info.duration_ms != expected.info.duration_ms) {
+            bench.mismatches++;
+        }
+        mp3_session_stats_t stats{};
+        mp3_session_get_stats(slot.session, &stats);
+        bench.reads += stats.read_calls;
+        bench.runs++;
+        slot.file.close();
+    };
+
+    // Следующий файл в слот; false — файлы кончились
+    const auto start = [&](Slot& slot) {
+        while (next < total) {
+            slot.index = next++ % paths.size();
+            mp3_audio_info_t info{};
+            if (!slot.file.open(paths[slot.index].c_str())) {
+                bench.mismatches++;
+                continue;
+            }
+            slot.file.setReader(&reader);
+            const mp3_host_api_t api = slot.file.hostApi();
+            mp3_result_t code = slot.session ? mp3_session_reset(slot.session, &api)
+                                             : mp3_session_init(detector, &api, &slot.session);
+            if (code == MP3_OK) {
+                code = mp3_session_run_async(slot.session, &options, &info);
+            }
+            if (code == MP3_ERR_PENDING) {
+                inFlight[slot.session] = &slot;
+                return true;
+            }
+            finish(slot, code, info);
+        }
+        return false;
+    };
+
+    const auto started = std::chrono::steady_clock::now();
+    for (auto& slot : slots) {
+        start(slot);
+    }
+    while (!inFlight.empty()) {
+        for (const auto& done : reader.wait()) {
+            mp3_audio_info_t info{};
+            const mp3_result_t code =
+                mp3_session_complete(done.session, done.result, done.length, &info);
+            if (code == MP3_ERR_PENDING) {
+                continue;
+            }
+            Slot& slot = *inFlight[done.session];
+            inFlight.erase(done.session);
+            finish(slot, code, info);
+            start(slot);
+        }
+    }
+    bench.totalUs = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - started).count();
+
+    for (auto& slot : slots) {
+        mp3_session_deinit(slot.session);
+    }
+    mp3_detector_destroy(detector);
+    return bench;
+}
+
+#ifdef MP3_ANALYZE_TASK_AVAILABLE
+/// То же корутинами: круг — все файлы разом, по задаче на файл
+static AsyncBench benchCoroutines(
+    const std::vector<fs::path>& paths,
+    const std::vector<FileBench>& reference,
+    const mp3_analyze_options_t& options,
+    unsigned depth,
+    uint32_t latencyUs,
+    unsigned rounds
+) {
+    AsyncBench bench{true, depth, latencyUs, 0, 0, 0.0, 0};
+    mp3_detector_t* detector = mp3_detector_create();
+    mp3::AsyncReader reader(depth, latencyUs);
+    mp3::ReadDispatcher dispatcher;
+
+    const auto started = std::chrono::steady_clock::now();
+    for (unsigned round = 0; round < rounds; ++round) {
+        std::vector<mp3::FileSource> files(paths.size());
+        std::vector<mp3::Task<mp3::AnalyzeResult>> tasks;
+        tasks.reserve(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (!files[i].open(paths[i].c_str())) {
+                bench.mismatches++;
+                continue;
+            }
+            files[i].setReader(&reader);
+            tasks.push_back(mp3::analyzeAsync(detector, files[i].hostApi(), dispatcher, options));
+            tasks.back().start();
+        }
+        mp3::pumpReads(reader, dispatcher);
+
+        size_t next = 0;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (!files[i].isOpen()) {
+                continue;
+            }
+            const mp3::AnalyzeResult& r = tasks[next++].result();
+            if (r.code != reference[i].code || r.info.duration_ms != reference[i].info.duration_ms) {
+                bench.mismatches++;
+            }
+            bench.reads += r.stats.read_calls;
+            bench.runs++;
+        }
+    }
+    bench.totalUs = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - started).count();
+
+    mp3_detector_destroy(detector);
+    return bench;
+}
+#endif
+
+static double filesPerSec(const AsyncBench& bench) {
+    return bench.totalUs > 0.0 ? bench.runs * 1e6 / bench.totalUs : 0.0;
+}
+
+// ============================================================================
+// Поиск sync-слова
+// ============================================================================
+
+struct SyncBench {
+    uint8_t impl;
+    const char* pattern;
+    double mbPerSec;
+    uint64_t candidates;
+    bool match;                     ///< Кандидаты совпали со scalar-эталоном
+};
+
+/// Все кандидаты sync-слова в буфере, как их перебирает анализатор
+static std::vector<size_t> allCandidates(uint8_t impl, const uint8_t* p, size_t len) {
+    std::vector<size_t> found;
+    size_t pos = 0;
+    while (pos < len) {
+        const size_t hit = mp3_native::find_sync_with(impl, p + pos, len - pos);
+        if (hit == len - pos) {
+            break;
+        }
+        found.push_back(pos + hit);
+        pos += hit + 1;
+    }
+    return found;
+}
+
+/// Сравнить реализацию со scalar на хвостах и невыровненных кусках
+static bool syncMatchesScalar(uint8_t impl, const std::vector<uint8_t>& data) {
+    if (allCandidates(impl, data.data(), data.size()) !=
+        allCandidates(mp3_native::SYNC_SCALAR, data.data(), data.size())) {
+        return false;
+    }
+    for (size_t start = 0; start < 64 && start < data.size(); ++start) {
+        for (size_t len = 0; len <= 80 && start + len <= data.size(); ++len) {
+            if (mp3_native::find_sync_with(impl, data.data() + start, len) !=
+                mp3_native::find_sync_scalar(data.data() + start, len)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static std::vector<SyncBench> benchSync(
+    const std::vector<fs::path>& paths,
+    unsigned iterations,
+    bool* allMatch
+) {
+    constexpr size_t kBufferSize = 16u * 1024u * 1024u;
+
+    // Мусор: ~1 кандидат на 2 KB, как в повреждённом потоке; паддинг: нули
+    std::vector<uint8_t> garbage(kBufferSize);
+    uint32_t x = 0x12345678u;
+    for (auto& b : garbage) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        b = static_cast<uint8_t>(x);
+    }
+    const std::vector<uint8_t> padding(kBufferSize, 0);
+
+    // Для проверки — ещё и сами тестовые файлы, и буфер из одних 0xFF
+    std::vector<std::vector<uint8_t>> samples = {garbage, std::vector<uint8_t>(4096, 0xFF)};
+    for (const auto& path : paths) {
+        std::ifstream in(path, std::ios::binary);
+        samples.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    const struct {
+        const char* name;
+        const std::vector<uint8_t>* data;
+    } patterns[] = {{"garbage", &garbage}, {"padding", &padding}};
+
+    const unsigned rounds = std::max(1u, std::min(iterations, 10u));
+    std::vector<SyncBench> results;
+    *allMatch = true;
+
+    for (uint8_t impl = 0; impl < mp3_native::SYNC_IMPL_COUNT; ++impl) {
+        if (!mp3_native::sync_impl_available(impl)) {
+            continue;
+        }
+
+        bool match = true;
+        for (const auto& sample : samples) {
+            match = match && syncMatchesScalar(impl, sample);
+        }
+        *allMatch = *allMatch && match;
+
+        for (const auto& pattern : patterns) {
+            SyncBench r{impl, pattern.name, 0.0, 0, match};
+            const auto started = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < rounds; ++i) {
+                r.candidates = allCandidates(impl, pattern.data->data(), pattern.data->size()).size();
+            }
+            const double us = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - started).count();
+            r.mbPerSec = mbPerSec(pattern.data->size(), rounds, us);
+            results.push_back(r);
+        }
+    }
+    return results;
+}
+
+// ============================================================================
+// JSON
+// ============================================================================
+
+static void writeJsonString(FILE* out, const std::string& s) {
+    fputc('"', out);
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void writeJson(
+    FILE* out,
+    const std::vector<FileBench>& files,
+    unsigned iterations,
+    bool useMmap,
+    const char* memory,
+    const mp3_analyze_options_t& options,
+    unsigned threads,
+    uint32_t stepBytes,
+    const std::vector<SyncBench>& sync,
+    const std::vector<AsyncBench>& async
+) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"mp3DurationDetector\",\n");
+    fprintf(out, "  \"iterations\": %u,\n", iterations);
+    fprintf(out, "  \"source\": \"%s\",\n", useMmap ? "mmap" : "pread");
+    fprintf(out, "  \"memory\": \"%s\",\n", memory);
+    fprintf(out, "  \"mode\": \"%s\",\n", modeName(options.mode));
+    fprintf(out, "  \"parallel\": %u,\n", threads);
+    fprintf(out, "  \"step_bytes\": %u,\n", stepBytes);
+
+    if (!async.empty()) {
+        fprintf(out, "  \"async\": [\n");
+        for (size_t i = 0; i < async.size(); ++i) {
+            const AsyncBench& a = async[i];
+            fprintf(out,
+                    "    {\"coroutine\": %s, \"depth\": %u, \"latency_us\": %u, "
+                    "\"runs\": %zu, \"reads\": %llu, "
+                    "\"total_ms\": %.1f, \"files_per_s\": %.1f, \"mismatches\": %zu}%s\n",
+                    a.coroutine ? "true" : "false", a.depth, a.latencyUs, a.runs,
+                    static_cast<unsigned long long>(a.reads),
+                    a.totalUs / 1000.0, filesPerSec(a), a.mismatches,
+                    (i + 1 < async.size()) ? "," : "");
+        }
+        fprintf(out, "  ],\n");
+    }
+
+    fprintf(out, "  \"sync_scan\": {\"selected\": \"%s\", \"results\": [\n",
+            mp3_native::sync_impl_name(mp3_native::sync_impl()));
+    for (size_t i = 0; i < sync.size(); ++i) {
+        fprintf(out,
+                "    {\"impl\": \"%s\", \"pattern\": \"%s\", \"mb_per_s\": %.1f, "
+                "\"candidates\": %llu, \"matches_scalar\": %s}%s\n",
+                mp3_native::sync_impl_name(sync[i].impl),
+                sync[i].pattern,
+                sync[i].mbPerSec,
+                static_cast<unsigned long long>(sync[i].candidates),
+                sync[i].match ? "true" : "false",
+                (i + 1 < sync.size()) ? "," : "");
+    }
+    fprintf(out, "  ]},\n");
+
+    fprintf(out, "  \"files\": [\n");
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        const FileBench& f = files[i];
+        fprintf(out, "    {\"name\": ");
+        writeJsonString(out, f.name);
+        fprintf(out,
+                ", \"size\": %llu, \"code\": %d, \"status\": \"%s\", "
+                "\"duration_ms\": %u, \"error_ms\": %u, \"sample_points\": %u, "
+                "\"mode_used\": \"%s\", "
+                "\"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f, "
+                "\"mb_per_s\": %.1f, \"effective_mb_per_s\": %.1f, "
+                "\"read_calls\": %u, \"max_request\": %u, "
+                "\"bytes_requested\": %llu, \"bytes_returned\": %llu, "
+                "\"frames_inspected\": %llu, \"id3_bytes_skipped\": %llu, "
+                "\"phase_us\": {\"id3\": %llu, \"sync\": %llu, \"vbr\": %llu, "
+                "\"scan\": %llu}, \"steps\": %u, \"max_step_us\": %.2f, "
+                "\"first_result_p50_us\": %.2f, \"estimates\": %u, "
+                "\"allocs_per_run\": %.2f}%s\n",
+                static_cast<unsigned long long>(f.size),
+                static_cast<int>(f.code),
+                mp3_error_string(f.code),
+                f.info.duration_ms,
+                f.estimate.error_ms,
+                f.estimate.sample_points,
+                modeName(f.info.mode),
+                percentile(f.latenciesUs, 0.50),
+                percentile(f.latenciesUs, 0.99),
+                f.latenciesUs.empty() ? 0.0 : f.latenciesUs.back(),
+                mbPerSec(f.stats.bytes_returned, iterations, f.totalUs),
+                mbPerSec(f.size, iterations, f.totalUs),
+                f.stats.read_calls,
+                f.stats.max_request,
+                static_cast<unsigned long long>(f.stats.bytes_requested),
+                static_cast<unsigned long long>(f.stats.bytes_returned),
+                static_cast<unsigned long long>(f.stats.frames_inspected),
+                static_cast<unsigned long long>(f.stats.id3_bytes_skipped),
+                static_cast<unsigned long long>(f.stats.phase_us[MP3_PHASE_ID3]),
+                static_cast<unsigned long long>(f.stats.phase_us[MP3_PHASE_SYNC]),
+                static_cast<unsigned long long>(f.stats.phase_us[MP3_PHASE_VBR]),
+                static_cast<unsigned long long>(f.stats.phase_us[MP3_PHASE_SCAN]),
+                f.stats.steps,
+                f.maxStepUs,
+                percentile(f.firstResultUs, 0.50),
+                f.estimates,
+                f.allocsPerRun,
+                (i + 1 < files.size()) ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+}
+
+// ============================================================================
+// main
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+#ifdef TEST_AUDIO_DIR
+    const char* audioDir = TEST_AUDIO_DIR;
+#else
+    const char* audioDir = "../test_audio";
+#endif
+
+    unsigned iterations = 50;
+    bool useMmap = false;
+    const char* memory = "pool";
+    mp3_analyze_options_t options{};
+    const char* outPath = nullptr;
+    unsigned threads = 1;
+    uint32_t stepBytes = 0;
+    unsigned asyncDepth = 0;
+    uint32_t latencyUs = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((std::strcmp(argv[i], "--iterations") == 0 || std::strcmp(argv[i], "-n") == 0) &&
+            i + 1 < argc) {
+            iterations = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--mmap") == 0) {
+            useMmap = true;
+        } else if (std::strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (std::strcmp(mode, "fast") == 0) {
+                options.mode = MP3_MODE_FAST_ESTIMATE;
+            } else if (std::strcmp(mode, "exact") == 0) {
+                options.mode = MP3_MODE_EXACT_SCAN;
+            } else if (std::strcmp(mode, "xing") == 0) {
+                options.mode = MP3_MODE_TRUST_XING;
+            } else {
+                fprintf(stderr, "ERROR: unknown --mode '%s' (xing, fast, exact)\n", mode);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            memory = argv[++i];
+        } else if (std::strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            stepBytes = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--async") == 0 && i + 1 < argc) {
+            asyncDepth = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latencyUs = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else {
+            audioDir = argv[i];
+        }
+    }
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    if (!fs::exists(audioDir) || !fs::is_directory(audioDir)) {
+        fprintf(stderr, "ERROR: directory '%s' does not exist\n", audioDir);
+        return 1;
+    }
+
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(audioDir)) {
+        auto ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (entry.is_regular_file() && ext == ".mp3") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    // pool / arena: сессия берётся из памяти детектора, в замер не попадает
+    // аллокация; heap: каждая сессия — через alloc хоста
+    mp3_detector_config_t config{};
+    config.alloc = countingAlloc;
+    config.free = countingFree;
+    if (std::strcmp(memory, "pool") == 0) {
+        config.session_pool_capacity = 1;
+    } else if (std::strcmp(memory, "arena") == 0) {
+        config.arena_size = mp3_session_storage_size();
+    } else if (std::strcmp(memory, "heap") != 0) {
+        fprintf(stderr, "ERROR: unknown --memory '%s' (pool, arena, heap)\n", memory);
+        return 1;
+    }
+    mp3_detector_t* detector = mp3_detector_create_ex(&config);
+    if (!detector) {
+        fprintf(stderr, "ERROR: cannot create detector\n");
+        return 1;
+    }
+
+    // 1 — без parallel_for: подсчёт последовательный, как у прошивки
+    std::unique_ptr<mp3::ParallelFor> pool;
+    if (threads != 1) {
+        pool = std::make_unique<mp3::ParallelFor>(threads);
+        threads = pool->threads();
+    }
+
+    std::vector<FileBench> results;
+    results.reserve(paths.size());
+    for (const auto& filePath : paths) {
+        FileBench f;
+        benchFile(detector, filePath, iterations, useMmap, options, pool.get(), stepBytes, f);
+        results.push_back(std::move(f));
+
+        const FileBench& r = results.back();
+        fprintf(stderr, "%-45s  p50 %9.1f us  p99 %9.1f us  %8.1f MB/s  %6llu calls  %s\n",
+                r.name.c_str(),
+                percentile(r.latenciesUs, 0.50),
+                percentile(r.latenciesUs, 0.99),
+                mbPerSec(r.stats.bytes_returned, iterations, r.totalUs),
+                static_cast<unsigned long long>(r.stats.read_calls),
+                mp3_error_string(r.code));
+        if (stepBytes) {
+            fprintf(stderr, "%-45s  %6u steps of %u bytes, max step %9.1f us\n",
+                    "", r.stats.steps, stepBytes, r.maxStepUs);
+        }
+    }
+
+    // Глубина 1 — та же задержка без перекрытия: база для сравнения
+    std::vector<AsyncBench> async;
+    if (asyncDepth) {
+        const unsigned rounds = std::max(1u, std::min(iterations, 10u));
+        for (unsigned depth : {1u, asyncDepth}) {
+            if (!async.empty() && depth == async.front().depth) {
+                break;
+            }
+            async.push_back(benchAsync(paths, results, options, depth, latencyUs, rounds));
+        }
+#ifdef MP3_ANALYZE_TASK_AVAILABLE
+        async.push_back(benchCoroutines(paths, results, options, asyncDepth, latencyUs, rounds));
+#endif
+        for (const auto& a : async) {
+            fprintf(stderr, "async%s depth %-4u latency %6u us  %8.1f files/s  %8llu reads  %s\n",
+                    a.coroutine ? " coro" : "", a.depth, a.latencyUs, filesPerSec(a),
+                    static_cast<unsigned long long>(a.reads),
+                    a.mismatches ? "MISMATCH" : "OK");
+        }
+    }
+
+    bool syncMatch = true;
+    const std::vector<SyncBench> sync = benchSync(paths, iterations, &syncMatch);
+    for (const auto& r : sync) {
+        fprintf(stderr, "sync %-8s %-8s %10.1f MB/s  %8llu candidates  %s\n",
+                mp3_native::sync_impl_name(r.impl),
+                r.pattern,
+                r.mbPerSec,
+                static_cast<unsigned long long>(r.candidates),
+                r.match ? "OK" : "MISMATCH");
+    }
+
+    FILE* out = stdout;
+    if (outPath) {
+        out = fopen(outPath, "w");
+        if (!out) {
+            fprintf(stderr, "ERROR: cannot write '%s'\n", outPath);
+            return 1;
+        }
+    }
+    writeJson(out, results, iterations, useMmap, memory, options, threads, stepBytes, sync, async);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    mp3_detector_destroy(detector);
+
+    if (!syncMatch) {
+        fprintf(stderr, "ERROR: SIMD sync scanner disagrees with scalar reference\n");
+        return 1;
+    }
+    for (const auto& a : async) {
+        if (a.mismatches) {
+            fprintf(stderr, "ERROR: asynchronous analysis disagrees with blocking run\n");
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -2,20 +2,48 @@
  * @file main.cpp
  * @brief Хост-тест mp3DurationDetector
  *
- * Прогоняет все .mp3 файлы из папки test_audio через mp3_analyze()
+ * Прогоняет все .mp3 файлы из папки test_audio через mp3_analyze_batch()
  * и выводит результат в табличном виде.
  *
  * Использование:
  *   ./TestCppApp                   — сканирует TEST_AUDIO_DIR (compile-time)
- *   ./TestCppApp /path/to/audio    — сканирует указанную папку
+ *   ./TestCppApp /path/to/audio    — сканирует указанную папку (рекурсивно)
+ *   ./TestCppApp --jobs N [dir]    — N потоков через mp3::BatchScanner
+ *                                    (0 — по числу ядер, 1 — последовательно)
+ *   ./TestCppApp --mmap [dir]      — читать через mmap (borrow_at) вместо pread;
+ *                                    извлечённый носитель — SIGBUS
+ *   ./TestCppApp --index FILE [--fingerprint] [dir]
+ *                                  — неизменные файлы берутся из индекса,
+ *                                    остальные разбираются и дописываются в него
+ *   ./TestCppApp --index FILE --watch [dir]
+ *                                  — после прохода следить за каталогом (inotify)
+ *                                    и обновлять индекс только по изменениям
+ *   ./TestCppApp --firmware-index FILE [dir]
+ *                                  — записать индекс для прошивки (mp3_index.h)
+ *                                    с путями от dir и проверить поиск по нему
+ *   ./TestCppApp --stdin           — разобрать поток со stdin (push-режим,
+ *                                    mp3_stream_feed), печатая текущую длительность
+ *
+ * После таблицы идут самопроверки (self_checks.h) на файлах того же
+ * каталога; провал любой из них — код выхода 1.
  */
 
 #include "mp3_lib.h"
+#include "mp3_index.h"
+#include "batch_scanner.h"
+#include "directory_watcher.h"
+#include "duration_index.h"
+#include "file_source.h"
+#include "firmware_index.h"
+#include "mmap_source.h"
+#include "self_checks.h"
 
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -23,83 +51,338 @@
 namespace fs = std::filesystem;
 
 // ============================================================================
-// Host-callback: чтение файла через stdio
+// Утилита: проверка расширения .mp3 (case-insensitive)
+// ============================================================================
+
+static bool isMp3(const fs::path& p) {
+    auto ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".mp3";
+}
+
+/// Все .mp3 под dir (рекурсивно), по порядку
+static std::vector<fs::path> collectFiles(const fs::path& dir) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && isMp3(it->path())) {
+            files.push_back(it->path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// ============================================================================
+// Пакетный анализ файлов
 // ============================================================================
 
-struct FileReadContext {
-    FILE* fp;
-    uint64_t fileSize;
+struct TestResult {
+    std::string name;
+    bool ok;
+    bool mismatch;              ///< mp3_analyze_buffer() разошёлся с callback-путём
+    bool cached;                ///< Взят из индекса
+    mp3_result_t code;
+    mp3_audio_info_t info;
 };
 
-static mp3_result_t host_read_at(
-    void* user_ctx,
-    uint64_t offset,
-    uint8_t* dst,
-    size_t requested,
-    size_t* out_read
+/// Сколько файлов держим открытыми одновременно за один mp3_analyze_batch()
+static constexpr size_t kBatchSize = 32;
+
+static void analyzeBatch(
+    mp3_detector_t* detector,
+    const fs::path* filePaths,
+    size_t count,
+    bool useMmap,
+    std::vector<TestResult>& results
 ) {
-    auto* ctx = static_cast<FileReadContext*>(user_ctx);
-    if (!ctx || !ctx->fp) return MP3_ERR_INVALID_PTR;
+    // pread по умолчанию; с mmap парсер читает через borrow_at без копий
+    mp3::FileSource files[kBatchSize];
+    mp3::MmapSource mapped[kBatchSize];
+    mp3_host_api_t sources[kBatchSize];
+    mp3_audio_info_t infos[kBatchSize];
+    mp3_result_t codes[kBatchSize];
+    size_t mapping[kBatchSize];
+    size_t opened = 0;
+
+    const size_t first = results.size();
+    for (size_t i = 0; i < count; ++i) {
+        TestResult r{};
+        r.name = filePaths[i].filename().string();
+        r.code = MP3_ERR_IO;
+        r.ok   = false;
+        std::memset(&r.info, 0, sizeof(r.info));
+        results.push_back(r);
+
+        const bool isOpen = useMmap ? mapped[opened].open(filePaths[i].c_str())
+                                    : files[opened].open(filePaths[i].c_str());
+        if (!isOpen) {
+            continue;
+        }
 
-    if (fseeko(ctx->fp, static_cast<off_t>(offset), SEEK_SET) != 0) {
-        return MP3_ERR_IO;
+        sources[opened] = useMmap ? mapped[opened].hostApi() : files[opened].hostApi();
+        mapping[opened] = first + i;
+        opened++;
     }
 
-    size_t rd = fread(dst, 1, requested, ctx->fp);
-    if (out_read) *out_read = rd;
+    mp3_analyze_batch(detector, sources, opened, infos, codes);
+
+    for (size_t j = 0; j < opened; ++j) {
+        TestResult& r = results[mapping[j]];
+        r.code = codes[j];
+        r.info = infos[j];
+        r.ok   = (r.code == MP3_OK && r.info.valid);
+
+        // Тот же файл из памяти должен дать тот же результат
+        std::vector<uint8_t> bytes;
+        const uint8_t* data = mapped[j].data();
+        size_t size = static_cast<size_t>(mapped[j].size());
+        if (!useMmap) {
+            bytes.resize(static_cast<size_t>(files[j].size()));
+            size = 0;
+            sources[j].read_at(sources[j].user_ctx, 0, bytes.data(), bytes.size(), &size);
+            data = bytes.data();
+        }
+        mp3_audio_info_t bufferInfo;
+        const mp3_result_t bufferCode = mp3_analyze_buffer(detector, data, size, &bufferInfo);
+        r.mismatch = (bufferCode != r.code ||
+                      std::memcmp(&bufferInfo, &r.info, sizeof(bufferInfo)) != 0);
+        if (r.mismatch) {
+            r.ok = false;
+        }
+    }
+}
 
-    return MP3_OK;
+// ============================================================================
+// Многопоточный анализ через mp3::BatchScanner
+// ============================================================================
+
+static void analyzeParallel(
+    mp3_detector_t* detector,
+    const std::vector<fs::path>& files,
+    unsigned jobs,
+    bool useMmap,
+    mp3::DurationIndex* index,
+    bool fingerprint,
+    std::vector<TestResult>& results
+) {
+    std::vector<std::string> paths;
+    paths.reserve(files.size());
+    for (const auto& filePath : files) {
+        paths.push_back(filePath.string());
+    }
+
+    mp3::BatchScanner scanner(detector, jobs);
+    scanner.setUseMmap(useMmap);
+    scanner.setIndex(index, fingerprint);
+    for (const auto& s : scanner.scan(paths)) {
+        TestResult r{};
+        r.name = fs::path(s.path).filename().string();
+        r.cached = s.cached;
+        r.code = s.code;
+        r.info = s.info;
+        r.ok   = (r.code == MP3_OK && r.info.valid);
+        results.push_back(r);
+    }
 }
 
 // ============================================================================
-// Утилита: проверка расширения .mp3 (case-insensitive)
+// Наблюдение за каталогом: индекс обновляется только по журналу изменений
 // ============================================================================
 
-static bool isMp3(const fs::path& p) {
-    auto ext = p.extension().string();
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-    return ext == ".mp3";
+static volatile std::sig_atomic_t g_stopWatching = 0;
+
+static void onStopSignal(int /*signal*/) {
+    g_stopWatching = 1;
+}
+
+static std::vector<std::string> onlyMp3(const std::vector<std::string>& paths) {
+    std::vector<std::string> out;
+    for (const auto& path : paths) {
+        if (isMp3(path)) {
+            out.push_back(path);
+        }
+    }
+    return out;
+}
+
+static int watchLibrary(
+    mp3_detector_t* detector,
+    const char* audioDir,
+    unsigned jobs,
+    mp3::DurationIndex* index,
+    const char* indexPath,
+    bool fingerprint
+) {
+    mp3::DirectoryWatcher watcher;
+    if (!watcher.start(audioDir)) {
+        printf("--- Watch: directory watching is not available here ---\n");
+        return 1;
+    }
+
+    mp3::BatchScanner scanner(detector, jobs);
+    scanner.setIndex(index, fingerprint);
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    printf("--- Watching %s (Ctrl+C to stop) ---\n", audioDir);
+    fflush(stdout);
+
+    while (!g_stopWatching) {
+        if (!watcher.poll(500)) {
+            printf("--- Watch: inotify read failed ---\n");
+            return 1;
+        }
+
+        mp3::DirectoryChanges changes = watcher.takeChanges();
+        changes.modified = onlyMp3(changes.modified);
+        changes.removed = onlyMp3(changes.removed);
+        if (changes.empty()) {
+            continue;
+        }
+
+        std::vector<mp3::ScanResult> results;
+        size_t removed = changes.removed.size();
+        if (changes.overflow) {
+            // Журнал неполный — полный пересмотр (неизменные файлы всё равно из индекса)
+            std::vector<std::string> paths;
+            for (const auto& file : collectFiles(audioDir)) {
+                paths.push_back(file.string());
+            }
+            results = scanner.scan(paths);
+            removed = index->retain(paths);
+            printf("~ full rescan: %zu files\n", paths.size());
+        } else {
+            results = scanner.update(changes);
+            for (const auto& path : changes.removed) {
+                printf("- %s\n", path.c_str());
+            }
+        }
+
+        for (const auto& r : results) {
+            if (r.cached) {
+                continue;
+            }
+            if (r.code == MP3_OK && r.info.valid) {
+                printf("+ %s  %u ms\n", r.path.c_str(), r.info.duration_ms);
+            } else {
+                printf("+ %s  FAIL [%s]\n", r.path.c_str(), mp3_error_string(r.code));
+            }
+        }
+        const bool saved = index->save(indexPath);
+        printf("--- Index: %zu updated, %zu removed, %zu entries %s %s ---\n",
+               results.size(), removed, index->size(),
+               saved ? "saved to" : "NOT saved to", indexPath);
+        fflush(stdout);
+    }
+    return 0;
 }
 
 // ============================================================================
-// Вывод результата анализа одного файла
+// Поток со stdin: push-режим без произвольного доступа
 // ============================================================================
 
-struct TestResult {
-    std::string name;
-    bool ok;
-    mp3_result_t code;
-    mp3_audio_info_t info;
-};
+static int analyzeStdin(mp3_detector_t* detector) {
+    // Размер неизвестен, read_at нет: байты отдаются сессии по мере прихода
+    mp3_host_api_t api{};
+    mp3_session_t* session = nullptr;
+    mp3_result_t result = mp3_session_init(detector, &api, &session);
+    if (result == MP3_OK) {
+        result = mp3_stream_begin(session, nullptr);
+    }
+    if (result != MP3_OK) {
+        fprintf(stderr, "ERROR: stream analysis is not available [%s]\n", mp3_error_string(result));
+        mp3_session_deinit(session);
+        return 1;
+    }
+
+    constexpr uint64_t kReportEvery = 16u * 1024u * 1024u;
+    static uint8_t buffer[64 * 1024];
+    uint64_t received = 0;
+    uint64_t nextReport = kReportEvery;
+    mp3_audio_info_t info{};
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+        result = mp3_stream_feed(session, buffer, got, &info);
+        received += got;
+        if (result != MP3_OK) {
+            break;
+        }
+        if (received >= nextReport) {
+            printf("~ %llu MiB: %u ms\n",
+                   static_cast<unsigned long long>(received >> 20), info.duration_ms);
+            fflush(stdout);
+            nextReport += kReportEvery;
+        }
+    }
 
-static TestResult analyzeFile(mp3_detector_t* detector, const fs::path& filePath) {
-    TestResult r{};
-    r.name = filePath.filename().string();
-    r.code = MP3_ERR_IO;
-    r.ok   = false;
-    std::memset(&r.info, 0, sizeof(r.info));
+    result = mp3_stream_finish(session, &info);
+    mp3_session_deinit(session);
 
-    FILE* fp = fopen(filePath.c_str(), "rb");
-    if (!fp) {
-        return r;
+    if (result != MP3_OK || !info.valid) {
+        printf("stdin: %llu bytes  FAIL [%s]\n",
+               static_cast<unsigned long long>(received), mp3_error_string(result));
+        return 1;
     }
+    printf("stdin: %llu bytes  %u ms  %u Hz  %u ch  %u bps  OK\n",
+           static_cast<unsigned long long>(received), info.duration_ms,
+           info.sample_rate, info.channels, info.bitrate);
+    return 0;
+}
 
-    fseeko(fp, 0, SEEK_END);
-    uint64_t fileSize = static_cast<uint64_t>(ftello(fp));
-    fseeko(fp, 0, SEEK_SET);
+// ============================================================================
+// Индекс для прошивки
+// ============================================================================
 
-    FileReadContext ctx{fp, fileSize};
+/// Записать индекс и найти в нём каждый файл так, как это сделает прошивка
+static bool writeFirmwareIndex(
+    const char* indexPath,
+    const fs::path& root,
+    const std::vector<fs::path>& files,
+    const std::vector<TestResult>& results
+) {
+    mp3::FirmwareIndexWriter writer;
+    std::vector<std::string> relative;
+    relative.reserve(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::error_code ec;
+        const uint64_t size = fs::file_size(files[i], ec);
+        relative.push_back(fs::relative(files[i], root).generic_string());
+        writer.add(relative.back(), ec ? 0 : size, results[i].code, results[i].info);
+    }
 
-    mp3_host_api_t host_api{};
-    host_api.user_ctx    = &ctx;
-    host_api.source_size = fileSize;
-    host_api.read_at     = host_read_at;
+    size_t dropped = 0;
+    if (!writer.write(indexPath, &dropped)) {
+        printf("--- Firmware index: cannot write %s ---\n", indexPath);
+        return false;
+    }
 
-    r.code = mp3_analyze(detector, &host_api, &r.info);
-    r.ok   = (r.code == MP3_OK && r.info.valid);
+    // Поиск через read_at — как у прошивки, читающей индекс по секторам
+    mp3::FileSource source;
+    mp3_index_t index{};
+    if (!source.open(indexPath)) {
+        return false;
+    }
+    const mp3_host_api_t api = source.hostApi();
+    if (mp3_index_open(api.read_at, api.user_ctx, api.source_size, &index) != MP3_OK) {
+        printf("--- Firmware index: %s is not readable ---\n", indexPath);
+        return false;
+    }
+
+    size_t verified = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        mp3_index_entry_t entry;
+        if (mp3_index_find(api.read_at, api.user_ctx, &index,
+                           mp3_index_hash_path(relative[i].c_str()), &entry) == MP3_OK &&
+            entry.duration_ms == results[i].info.duration_ms &&
+            entry.code == static_cast<uint8_t>(results[i].code)) {
+            verified++;
+        }
+    }
 
-    fclose(fp);
-    return r;
+    printf("--- Firmware index: %u entries (%zu dropped) in %s, %zu/%zu found ---\n",
+           index.entry_count, dropped, indexPath, verified, files.size());
+    return verified + dropped == files.size();
 }
 
 // ============================================================================
@@ -113,7 +396,39 @@ int main(int argc, char* argv[]) {
     const char* defaultDir = "../test_audio";
 #endif
 
-    const char* audioDir = (argc > 1) ? argv[1] : defaultDir;
+    const char* audioDir = defaultDir;
+    unsigned jobs = 1;
+    const char* indexPath = nullptr;
+    const char* firmwareIndexPath = nullptr;
+    bool fingerprint = false;
+    bool watch = false;
+    bool fromStdin = false;
+    bool useMmap = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((std::strcmp(argv[i], "--jobs") == 0 || std::strcmp(argv[i], "-j") == 0) &&
+            i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            indexPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--firmware-index") == 0 && i + 1 < argc) {
+            firmwareIndexPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--watch") == 0) {
+            watch = true;
+        } else if (std::strcmp(argv[i], "--fingerprint") == 0) {
+            fingerprint = true;
+        } else if (std::strcmp(argv[i], "--stdin") == 0) {
+            fromStdin = true;
+        } else if (std::strcmp(argv[i], "--mmap") == 0) {
+            useMmap = true;
+        } else {
+            audioDir = argv[i];
+        }
+    }
+
+    if (fromStdin) {
+        return analyzeStdin(mp3_detector_instance());
+    }
 
     printf("=== mp3DurationDetector — TestCppApp ===\n");
     printf("Audio directory: %s\n\n", audioDir);
@@ -123,14 +438,13 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    // Собираем .mp3 файлы
-    std::vector<fs::path> files;
-    for (const auto& entry : fs::directory_iterator(audioDir)) {
-        if (entry.is_regular_file() && isMp3(entry.path())) {
-            files.push_back(entry.path());
-        }
+    if (watch && !indexPath) {
+        fprintf(stderr, "ERROR: --watch needs --index FILE\n");
+        return 1;
     }
-    std::sort(files.begin(), files.end());
+
+    // Собираем .mp3 файлы
+    const std::vector<fs::path> files = collectFiles(audioDir);
 
     if (files.empty()) {
         printf("No .mp3 files found in %s\n", audioDir);
@@ -149,12 +463,33 @@ int main(int argc, char* argv[]) {
            std::string(50, '-').c_str(), "--------", "--------",
            "----", "--------", "------");
 
+    const auto started = std::chrono::steady_clock::now();
+
+    // Индекс читается в замер: тёплый прогон — это загрузка индекса и stat()
+    mp3::DurationIndex index;
+    if (indexPath) {
+        index.load(indexPath);
+    }
+
+    std::vector<TestResult> results;
+    results.reserve(files.size());
+    if (jobs == 1 && !indexPath) {
+        for (size_t i = 0; i < files.size(); i += kBatchSize) {
+            const size_t count = std::min(kBatchSize, files.size() - i);
+            analyzeBatch(detector, &files[i], count, useMmap, results);
+        }
+    } else {
+        analyzeParallel(detector, files, jobs, useMmap, indexPath ? &index : nullptr, fingerprint,
+                        results);
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+
     int passed = 0;
     int failed = 0;
 
-    for (const auto& filePath : files) {
-        auto r = analyzeFile(detector, filePath);
-
+    for (const auto& r : results) {
         if (r.ok) {
             printf("%-50s  %5u ms  %5u Hz  %4u  %6u bp  OK\n",
                    r.name.c_str(),
@@ -166,13 +501,51 @@ int main(int argc, char* argv[]) {
         } else {
             printf("%-50s  %8s  %8s  %4s  %8s  FAIL [%s]\n",
                    r.name.c_str(), "-", "-", "-", "-",
-                   mp3_error_string(r.code));
+                   r.mismatch ? "buffer path mismatch" : mp3_error_string(r.code));
             failed++;
         }
     }
 
     printf("\n--- Results: %d passed, %d failed, %d total ---\n",
            passed, failed, passed + failed);
+    printf("--- Analyzed in %.1f ms (jobs: %u) ---\n", elapsedMs, jobs);
+
+    printf("\nSelf-checks:\n");
+    const CheckTotals checks = runSelfChecks(files);
+    printf("--- Checks: %d passed, %d failed, %d skipped ---\n",
+           checks.passed, checks.failed, checks.skipped);
+    if (checks.failed > 0) {
+        failed += checks.failed;
+    }
+
+    if (indexPath) {
+        const size_t cached = static_cast<size_t>(std::count_if(
+            results.begin(), results.end(), [](const TestResult& r) { return r.cached; }));
+
+        // Каталог обойдён целиком: записи файлов, которых в нём нет, устарели
+        std::vector<std::string> paths;
+        paths.reserve(files.size());
+        for (const auto& file : files) {
+            paths.push_back(file.string());
+        }
+        const size_t removed = index.retain(paths);
+
+        const bool saved = index.save(indexPath);
+        printf("--- Index: %zu from index, %zu analyzed, %zu removed, %zu entries %s %s ---\n",
+               cached, results.size() - cached, removed, index.size(),
+               saved ? "saved to" : "NOT saved to", indexPath);
+        if (!saved) {
+            return 1;
+        }
+    }
+
+    if (firmwareIndexPath && !writeFirmwareIndex(firmwareIndexPath, audioDir, files, results)) {
+        return 1;
+    }
+
+    if (watch) {
+        return watchLibrary(detector, audioDir, jobs, &index, indexPath, fingerprint);
+    }
 
     return (failed > 0) ? 1 : 0;
 }
@@ -0,0 +1,1336 @@
+/**
+ * @file self_checks.cpp
+ * @brief Самопроверки TestCppApp (см. self_checks.h)
+ */
+
+#include "self_checks.h"
+
+#include "directory_watcher.h"
+#include "duration_index.h"
+#include "mp3_native.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// ============================================================================
+// Источник в памяти: read_at по вектору со счётчиком вызовов
+// ============================================================================
+
+struct MemorySource {
+    std::vector<uint8_t> bytes;
+    std::atomic<uint32_t> reads{0};
+
+    static mp3_result_t readAt(void* ctx, uint64_t offset, uint8_t* dst,
+                               size_t requested, size_t* out_read) {
+        auto* self = static_cast<MemorySource*>(ctx);
+        self->reads.fetch_add(1, std::memory_order_relaxed);
+        const uint64_t size = self->bytes.size();
+        const size_t n = offset >= size ? 0 : static_cast<size_t>(
+            std::min<uint64_t>(requested, size - offset));
+        if (n) {
+            std::memcpy(dst, self->bytes.data() + offset, n);
+        }
+        *out_read = n;
+        return MP3_OK;
+    }
+
+    mp3_host_api_t hostApi() {
+        mp3_host_api_t api{};
+        api.user_ctx = this;
+        api.source_size = bytes.size();
+        api.read_at = &MemorySource::readAt;
+        return api;
+    }
+};
+
+bool loadFile(const fs::path& path, std::vector<uint8_t>& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+const fs::path* findFixture(const std::vector<fs::path>& files, const char* name) {
+    for (const auto& file : files) {
+        if (file.filename() == name) {
+            return &file;
+        }
+    }
+    return nullptr;
+}
+
+// ============================================================================
+// Учёт проверок
+// ============================================================================
+
+class Checker {
+public:
+    void expect(const char* name, bool ok, const std::string& detail = std::string()) {
+        if (ok) {
+            printf("  %-58s  OK\n", name);
+            totals_.passed++;
+        } else {
+            printf("  %-58s  FAIL [%s]\n", name, detail.c_str());
+            totals_.failed++;
+        }
+    }
+
+    void skip(const char* name, const char* fixture) {
+        printf("  %-58s  SKIP [no %s]\n", name, fixture);
+        totals_.skipped++;
+    }
+
+    const CheckTotals& totals() const { return totals_; }
+
+private:
+    CheckTotals totals_;
+};
+
+/**
+ * Сессии, живые одновременно у нескольких потоков: их память
+ * (mp3_session_storage_size() байт) не должна пересекаться, а их
+ * число — превысить limit. Для арены ещё и лежать внутри неё.
+ */
+class LiveSessions {
+public:
+    explicit LiveSessions(size_t limit, const uint8_t* begin = nullptr, size_t size = 0)
+        : limit_(limit), begin_(begin), size_(size) {}
+
+    void acquired(mp3_session_t* session) {
+        const auto* p = reinterpret_cast<const uint8_t*>(session);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = live_.lower_bound(p);
+        const bool overlaps = (it != live_.end() && *it < p + span_) ||
+                              (it != live_.begin() && *std::prev(it) + span_ > p);
+        const bool outside = begin_ && (p < begin_ || p + span_ > begin_ + size_);
+        live_.insert(it, p);
+        if (overlaps || outside || live_.size() > limit_) {
+            violations_++;
+        }
+    }
+
+    void released(mp3_session_t* session) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_.erase(reinterpret_cast<const uint8_t*>(session));
+    }
+
+    size_t violations() const { return violations_; }
+
+private:
+    std::mutex mutex_;
+    std::set<const uint8_t*> live_;
+    size_t limit_;
+    const uint8_t* begin_;
+    size_t size_;
+    size_t span_ = mp3_session_storage_size();
+    size_t violations_ = 0;
+};
+
+// ============================================================================
+// Сгенерированные варианты файлов: без Xing/Info, с тегами вокруг
+// ============================================================================
+
+/// Размер подряд идущих ID3v2 в начале
+size_t leadingId3Size(const std::vector<uint8_t>& bytes) {
+    size_t pos = 0;
+    while (pos + 10 <= bytes.size() && std::memcmp(&bytes[pos], "ID3", 3) == 0) {
+        const uint8_t* h = &bytes[pos];
+        const size_t size = (size_t(h[6] & 0x7F) << 21) | (size_t(h[7] & 0x7F) << 14) |
+                            (size_t(h[8] & 0x7F) << 7) | size_t(h[9] & 0x7F);
+        pos += 10 + size + ((h[5] & 0x10) ? 10 : 0);
+    }
+    return pos;
+}
+
+/**
+ * Затереть метку Xing/Info/VBRI первого фрейма: файл становится
+ * «голым» CBR/VBR, длительность которого надо выводить из самих фреймов.
+ */
+bool stripVbrHeader(std::vector<uint8_t>& bytes) {
+    size_t pos = leadingId3Size(bytes);
+    while (pos + 1 < bytes.size() && !(bytes[pos] == 0xFF && (bytes[pos + 1] & 0xE0) == 0xE0)) {
+        pos++;
+    }
+    // Xing/Info — сразу за side info (4 + 9..32), VBRI — на 4 + 32
+    const size_t end = std::min(bytes.size(), pos + 4 + 32 + 4);
+    for (size_t at = pos + 4; at + 4 <= end; ++at) {
+        if (std::memcmp(&bytes[at], "Xing", 4) == 0 || std::memcmp(&bytes[at], "Info", 4) == 0 ||
+            std::memcmp(&bytes[at], "VBRI", 4) == 0) {
+            std::memset(&bytes[at], 0, 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+void putLe32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+/// Заголовок или футер APEv2: элементы + футер = size байт
+void putApeFrame(std::vector<uint8_t>& out, uint32_t size, uint32_t items, bool header) {
+    constexpr uint32_t kHasHeader = 1u << 31;
+    constexpr uint32_t kIsHeader = 1u << 29;
+    const char magic[] = "APETAGEX";
+    out.insert(out.end(), magic, magic + 8);
+    putLe32(out, 2000);
+    putLe32(out, size);
+    putLe32(out, items);
+    putLe32(out, kHasHeader | (header ? kIsHeader : 0));
+    out.insert(out.end(), 8, 0);
+}
+
+constexpr size_t kId3v2TagSize = 1u << 20;
+
+/**
+ * Обернуть файл тегами: ID3v2.4 на 1 MiB (паддинг) в начале, APEv2
+ * с заголовком и ID3v1 в конце. Возвращает, сколько байт тегов добавлено.
+ */
+size_t addTags(std::vector<uint8_t>& bytes) {
+    std::vector<uint8_t> out;
+    out.reserve(bytes.size() + kId3v2TagSize + 512);
+
+    const size_t body = kId3v2TagSize - 10;
+    const uint8_t id3[10] = {'I', 'D', '3', 4, 0, 0,
+                             uint8_t((body >> 21) & 0x7F), uint8_t((body >> 14) & 0x7F),
+                             uint8_t((body >> 7) & 0x7F), uint8_t(body & 0x7F)};
+    out.insert(out.end(), id3, id3 + sizeof(id3));
+    out.insert(out.end(), body, 0);
+    out.insert(out.end(), bytes.begin(), bytes.end());
+
+    const char key[] = "Title";
+    const char value[] = "self-check";
+    std::vector<uint8_t> item;
+    putLe32(item, sizeof(value) - 1);
+    putLe32(item, 0);
+    item.insert(item.end(), key, key + sizeof(key));
+    item.insert(item.end(), value, value + sizeof(value) - 1);
+    const uint32_t apeSize = static_cast<uint32_t>(item.size() + 32);
+    putApeFrame(out, apeSize, 1, true);
+    out.insert(out.end(), item.begin(), item.end());
+    putApeFrame(out, apeSize, 1, false);
+
+    out.push_back('T');
+    out.push_back('A');
+    out.push_back('G');
+    out.insert(out.end(), 125, ' ');
+
+    const size_t added = out.size() - bytes.size();
+    bytes.swap(out);
+    return added;
+}
+
+/// Один прогон сессии по источнику в памяти
+struct Analysis {
+    mp3_result_t code = MP3_ERR_UNKNOWN;
+    mp3_audio_info_t info{};
+    mp3_session_stats_t stats{};
+    mp3_duration_estimate_t estimate{};
+};
+
+Analysis analyzeMemory(MemorySource& source, uint8_t mode, mp3_progress_fn progress = nullptr,
+                       void* progressCtx = nullptr) {
+    Analysis a;
+    const mp3_host_api_t api = source.hostApi();
+    mp3_session_t* session = nullptr;
+    a.code = mp3_session_init(mp3_detector_instance(), &api, &session);
+    if (a.code != MP3_OK) {
+        return a;
+    }
+    mp3_analyze_options_t options{};
+    options.mode = mode;
+    options.progress = progress;
+    options.progress_ctx = progressCtx;
+    a.code = mp3_session_run_ex(session, &options, &a.info);
+    mp3_session_get_stats(session, &a.stats);
+    mp3_session_get_estimate(session, &a.estimate);
+    mp3_session_deinit(session);
+    return a;
+}
+
+/// Загрузить файл без Xing/Info и обёрнутый тегами; *added — байт тегов
+bool loadVariants(const std::vector<fs::path>& files, const char* fixture,
+                  MemorySource& stripped, MemorySource& tagged, size_t* added) {
+    const fs::path* path = findFixture(files, fixture);
+    if (!path || !loadFile(*path, stripped.bytes)) {
+        return false;
+    }
+    stripVbrHeader(stripped.bytes);
+    tagged.bytes = stripped.bytes;
+    *added = addTags(tagged.bytes);
+    return true;
+}
+
+bool sameInfo(const mp3_audio_info_t& a, const mp3_audio_info_t& b) {
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// ============================================================================
+// Сверка путей анализа с mp3_session_run
+// ============================================================================
+
+/// Все файлы каталога в памяти и их эталон по каждому режиму
+struct Library {
+    struct Entry {
+        std::string name;
+        std::unique_ptr<MemorySource> source;
+        mp3_result_t codes[3];
+        mp3_audio_info_t infos[3];
+    };
+    std::vector<Entry> entries;
+};
+
+constexpr uint8_t kModes[3] = {MP3_MODE_TRUST_XING, MP3_MODE_FAST_ESTIMATE, MP3_MODE_EXACT_SCAN};
+
+Library loadLibrary(const std::vector<fs::path>& files) {
+    Library library;
+    for (const auto& file : files) {
+        Library::Entry entry;
+        entry.name = file.filename().string();
+        entry.source = std::make_unique<MemorySource>();
+        if (!loadFile(file, entry.source->bytes)) {
+            continue;
+        }
+        for (size_t m = 0; m < 3; ++m) {
+            const Analysis a = analyzeMemory(*entry.source, kModes[m]);
+            entry.codes[m] = a.code;
+            entry.infos[m] = a.info;
+        }
+        library.entries.push_back(std::move(entry));
+    }
+    return library;
+}
+
+/**
+ * Первое расхождение с эталоном: "файл, режим: код/длительность против
+ * эталонных". Пусто — всё совпало байт в байт.
+ */
+std::string describeMismatch(const Library::Entry& entry, size_t m, mp3_result_t code,
+                             const mp3_audio_info_t& info) {
+    if (code == entry.codes[m] && sameInfo(info, entry.infos[m])) {
+        return std::string();
+    }
+    char text[192];
+    std::snprintf(text, sizeof(text), "%s mode %u: %s %u ms (mode %u) vs %s %u ms (mode %u)",
+                  entry.name.c_str(), kModes[m], mp3_error_string(code), info.duration_ms,
+                  info.mode, mp3_error_string(entry.codes[m]), entry.infos[m].duration_ms,
+                  entry.infos[m].mode);
+    return text;
+}
+
+/**
+ * Загрузить файл в source и разобрать его общим детектором (эталон).
+ * Нет файла — проверка пропущена; false — проверку дальше не вести.
+ */
+bool loadReference(Checker& checker, const char* name, const std::vector<fs::path>& files,
+                   const char* fixture, MemorySource& source, mp3_audio_info_t& expected) {
+    const fs::path* path = findFixture(files, fixture);
+    if (!path || !loadFile(*path, source.bytes)) {
+        checker.skip(name, fixture);
+        return false;
+    }
+    const mp3_host_api_t api = source.hostApi();
+    if (mp3_analyze(mp3_detector_instance(), &api, &expected) != MP3_OK) {
+        checker.expect(name, false, "reference analysis failed");
+        return false;
+    }
+    return true;
+}
+
+constexpr unsigned kStressThreads = 8;
+constexpr unsigned kStressRounds = 200;
+
+struct StressOutcome {
+    uint32_t completed = 0;         ///< Сессий взято и разобрано
+    uint32_t exhausted = 0;         ///< Отказов MP3_ERR_OUT_OF_MEMORY
+    uint32_t bad = 0;               ///< Прочих ошибок и расхождений с эталоном
+};
+
+/**
+ * kStressThreads потоков наперебой берут сессии детектора, разбирают
+ * source и закрывают их; потоков больше, чем сессий влезает.
+ */
+StressOutcome stressSessions(mp3_detector_t* detector, MemorySource& source,
+                             const mp3_audio_info_t& expected, LiveSessions& live) {
+    std::atomic<uint32_t> completed{0};
+    std::atomic<uint32_t> exhausted{0};
+    std::atomic<uint32_t> bad{0};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < kStressThreads; ++t) {
+        threads.emplace_back([&] {
+            const mp3_host_api_t api = source.hostApi();
+            for (unsigned round = 0; round < kStressRounds; ++round) {
+                mp3_session_t* session = nullptr;
+                const mp3_result_t code = mp3_session_init(detector, &api, &session);
+                if (code == MP3_ERR_OUT_OF_MEMORY) {
+                    exhausted.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (code != MP3_OK) {
+                    bad.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                live.acquired(session);
+                mp3_audio_info_t info;
+                if (mp3_session_run(session, &info) != MP3_OK ||
+                    std::memcmp(&info, &expected, sizeof(info)) != 0) {
+                    bad.fetch_add(1, std::memory_order_relaxed);
+                }
+                // Подержать сессию, чтобы потоки упирались в ёмкость
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                live.released(session);
+                mp3_session_deinit(session);
+                completed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    StressOutcome outcome;
+    outcome.completed = completed.load();
+    outcome.exhausted = exhausted.load();
+    outcome.bad = bad.load();
+    return outcome;
+}
+
+// ============================================================================
+// Пул сессий детектора
+// ============================================================================
+
+void checkSessionPool(Checker& checker, const std::vector<fs::path>& files) {
+    const char* fixture = "test_500ms_128cbr_stereo_44k1.mp3";
+    const char* name = "pool: concurrent exhaustion and slot reuse";
+    MemorySource source;
+    mp3_audio_info_t expected;
+    if (!loadReference(checker, name, files, fixture, source, expected)) {
+        return;
+    }
+    const mp3_host_api_t api = source.hostApi();
+
+    constexpr uint32_t kCapacity = 3;
+    mp3_detector_config_t config{};
+    config.session_pool_capacity = kCapacity;
+    mp3_detector_t* detector = mp3_detector_create_ex(&config);
+    if (!detector) {
+        checker.expect(name, false, "mp3_detector_create_ex failed");
+        return;
+    }
+
+    LiveSessions live(kCapacity);
+    const StressOutcome stress = stressSessions(detector, source, expected, live);
+
+    // После гонки все слоты свободны: ровно kCapacity сессий и отказ на следующей
+    mp3_session_t* sessions[kCapacity + 1] = {};
+    uint32_t reacquired = 0;
+    for (uint32_t i = 0; i < kCapacity; ++i) {
+        reacquired += mp3_session_init(detector, &api, &sessions[i]) == MP3_OK;
+    }
+    const mp3_result_t overflow = mp3_session_init(detector, &api, &sessions[kCapacity]);
+    for (uint32_t i = 0; i < kCapacity; ++i) {
+        if (sessions[i]) {
+            mp3_session_deinit(sessions[i]);
+        }
+    }
+    mp3_detector_destroy(detector);
+
+    char detail[160];
+    std::snprintf(detail, sizeof(detail),
+                  "violations %zu, bad %u, exhausted %u, reacquired %u/%u, overflow %s",
+                  live.violations(), stress.bad, stress.exhausted, reacquired, kCapacity,
+                  mp3_error_string(overflow));
+    checker.expect(name,
+                   live.violations() == 0 && stress.bad == 0 && stress.exhausted > 0 &&
+                       reacquired == kCapacity && overflow == MP3_ERR_OUT_OF_MEMORY,
+                   detail);
+}
+
+// ============================================================================
+// Bump-арена детектора
+// ============================================================================
+
+void checkSessionArena(Checker& checker, const std::vector<fs::path>& files) {
+    const char* fixture = "test_500ms_128cbr_stereo_44k1.mp3";
+    const char* name = "arena: concurrent bump and reset at zero live";
+    MemorySource source;
+    mp3_audio_info_t expected;
+    if (!loadReference(checker, name, files, fixture, source, expected)) {
+        return;
+    }
+    const mp3_host_api_t api = source.hostApi();
+
+    // Ровно две сессии; третья влезет, только если арена сбросилась
+    constexpr size_t kSessions = 2;
+    const size_t slot = (mp3_session_storage_size() + MP3_SESSION_STORAGE_ALIGN - 1) &
+                        ~static_cast<size_t>(MP3_SESSION_STORAGE_ALIGN - 1);
+    std::vector<uint64_t> arena((kSessions * slot) / sizeof(uint64_t) + 1);
+    auto* base = reinterpret_cast<uint8_t*>(arena.data());
+
+    mp3_detector_config_t config{};
+    config.arena = base;
+    config.arena_size = kSessions * slot;
+    mp3_detector_t* detector = mp3_detector_create_ex(&config);
+    if (!detector) {
+        checker.expect(name, false, "mp3_detector_create_ex failed");
+        return;
+    }
+
+    LiveSessions live(kSessions, base, config.arena_size);
+    const StressOutcome stress = stressSessions(detector, source, expected, live);
+
+    // Живых не осталось — вершина снова в начале арены
+    mp3_session_t* sessions[kSessions + 1] = {};
+    uint32_t reacquired = 0;
+    for (size_t i = 0; i < kSessions; ++i) {
+        reacquired += mp3_session_init(detector, &api, &sessions[i]) == MP3_OK;
+    }
+    const bool fromStart = reinterpret_cast<uint8_t*>(sessions[0]) == base;
+    const mp3_result_t overflow = mp3_session_init(detector, &api, &sessions[kSessions]);
+    for (size_t i = 0; i < kSessions; ++i) {
+        if (sessions[i]) {
+            mp3_session_deinit(sessions[i]);
+        }
+    }
+    mp3_detector_destroy(detector);
+
+    char detail[192];
+    std::snprintf(detail, sizeof(detail),
+                  "violations %zu, bad %u, completed %u, exhausted %u, reacquired %u, "
+                  "from start %d, overflow %s",
+                  live.violations(), stress.bad, stress.completed, stress.exhausted,
+                  reacquired, fromStart, mp3_error_string(overflow));
+    checker.expect(name,
+                   live.violations() == 0 && stress.bad == 0 && stress.exhausted > 0 &&
+                       stress.completed > kSessions && reacquired == kSessions && fromStart &&
+                       overflow == MP3_ERR_OUT_OF_MEMORY,
+                   detail);
+}
+
+// ============================================================================
+// Теги в начале и в конце: пропуск по размеру, без чтения
+// ============================================================================
+
+/// Лишние байты чтения с тегами: пара окон read-ahead у их заголовков
+constexpr uint64_t kTagReadSlack = 64u << 10;
+
+void checkTagSkipping(Checker& checker, const std::vector<fs::path>& files) {
+    const char* fixtures[] = {
+        "test_3sec_128cbr_stereo_44k1.mp3",
+        "test_4sec_64vbr_mono_22k05.mp3",
+        "test_2h_32vbr_stereo_44k1.mp3",
+    };
+    for (const char* fixture : fixtures) {
+        const std::string name = std::string("tags: ") + fixture;
+        MemorySource stripped;
+        MemorySource tagged;
+        size_t added = 0;
+        if (!loadVariants(files, fixture, stripped, tagged, &added)) {
+            checker.skip(name.c_str(), fixture);
+            continue;
+        }
+
+        const Analysis plainExact = analyzeMemory(stripped, MP3_MODE_EXACT_SCAN);
+        const Analysis tagExact = analyzeMemory(tagged, MP3_MODE_EXACT_SCAN);
+        const Analysis plainTrust = analyzeMemory(stripped, MP3_MODE_TRUST_XING);
+        const Analysis tagTrust = analyzeMemory(tagged, MP3_MODE_TRUST_XING);
+
+        // Теги не меняют ни результат, ни data_size, а из их байт читаются
+        // только окна read-ahead у заголовков — не мегабайт паддинга
+        const uint64_t skipped = tagTrust.stats.id3_bytes_skipped -
+                                 plainTrust.stats.id3_bytes_skipped;
+        const uint64_t extraRead = tagTrust.stats.bytes_returned -
+                                   std::min(tagTrust.stats.bytes_returned,
+                                            plainTrust.stats.bytes_returned);
+        char detail[192];
+        std::snprintf(detail, sizeof(detail),
+                      "exact %s/%s %u/%u ms, data %llu/%llu, trust %u/%u ms, "
+                      "skipped %llu of %zu, extra read %llu",
+                      mp3_error_string(plainExact.code), mp3_error_string(tagExact.code),
+                      plainExact.info.duration_ms, tagExact.info.duration_ms,
+                      (unsigned long long)plainExact.info.data_size,
+                      (unsigned long long)tagExact.info.data_size,
+                      plainTrust.info.duration_ms, tagTrust.info.duration_ms,
+                      (unsigned long long)skipped, added, (unsigned long long)extraRead);
+        checker.expect(name.c_str(),
+                       plainExact.code == MP3_OK && tagExact.code == MP3_OK &&
+                           sameInfo(plainExact.info, tagExact.info) &&
+                           plainTrust.code == MP3_OK && tagTrust.code == MP3_OK &&
+                           sameInfo(plainTrust.info, tagTrust.info) &&
+                           skipped == added && extraRead < kTagReadSlack,
+                       detail);
+    }
+}
+
+// ============================================================================
+// CBR без Xing: проверка в начале и в середине вместо подсчёта
+// ============================================================================
+
+/**
+ * Чтений на проверенный CBR: окно в начале, хвост и середина (фреймы
+ * середины могут не влезть в одно окно). ID3v2 в начале добавляет одно
+ * окно — его заголовок; теги в конце — ни одного.
+ */
+constexpr uint32_t kCbrMaxReads = 4;
+
+void checkCbrVerified(Checker& checker, const std::vector<fs::path>& files) {
+    // VBR проверку CBR не проходит и откатывается к точному подсчёту
+    const struct {
+        const char* fixture;
+        uint8_t mode;
+    } cases[] = {
+        {"test_3sec_128cbr_stereo_44k1.mp3", MP3_MODE_CBR_VERIFIED},
+        {"test_5sec_192cbr_mono_48k.mp3", MP3_MODE_CBR_VERIFIED},
+        {"test_2h_32cbr_stereo_44k1.mp3", MP3_MODE_CBR_VERIFIED},
+        {"test_2h_32abr_stereo_44k1.mp3", MP3_MODE_CBR_VERIFIED},
+        {"test_2h_32vbr_stereo_44k1.mp3", MP3_MODE_EXACT_SCAN},
+    };
+    for (const auto& c : cases) {
+        const std::string name = std::string("cbr verified: ") + c.fixture;
+        MemorySource stripped;
+        MemorySource tagged;
+        size_t added = 0;
+        if (!loadVariants(files, c.fixture, stripped, tagged, &added)) {
+            checker.skip(name.c_str(), c.fixture);
+            continue;
+        }
+
+        const Analysis exact = analyzeMemory(stripped, MP3_MODE_EXACT_SCAN);
+        const Analysis plain = analyzeMemory(stripped, MP3_MODE_TRUST_XING);
+        const Analysis wrapped = analyzeMemory(tagged, MP3_MODE_TRUST_XING);
+
+        // Тот же результат, что у подсчёта всех фреймов, кроме способа
+        mp3_audio_info_t expected = exact.info;
+        expected.mode = c.mode;
+        const bool fewReads = c.mode != MP3_MODE_CBR_VERIFIED ||
+                              (plain.stats.read_calls <= kCbrMaxReads &&
+                               wrapped.stats.read_calls <= plain.stats.read_calls + 1);
+        char detail[160];
+        std::snprintf(detail, sizeof(detail), "%s/%s, mode %u/%u, %u/%u/%u ms, %u/%u reads",
+                      mp3_error_string(plain.code), mp3_error_string(wrapped.code),
+                      plain.info.mode, wrapped.info.mode, exact.info.duration_ms,
+                      plain.info.duration_ms, wrapped.info.duration_ms,
+                      plain.stats.read_calls, wrapped.stats.read_calls);
+        checker.expect(name.c_str(),
+                       exact.code == MP3_OK && plain.code == MP3_OK && wrapped.code == MP3_OK &&
+                           sameInfo(plain.info, expected) && sameInfo(wrapped.info, expected) &&
+                           fewReads,
+                       detail);
+    }
+}
+
+// ============================================================================
+// VBR без Xing: оценка по выборке с доверительным интервалом
+// ============================================================================
+
+void checkSampledEstimate(Checker& checker, const std::vector<fs::path>& files) {
+    const char* fixtures[] = {
+        "test_2h_32vbr_stereo_44k1.mp3",
+        "test_2h_32abr_stereo_44k1.mp3",
+    };
+    for (const char* fixture : fixtures) {
+        const std::string name = std::string("sampled estimate: ") + fixture;
+        MemorySource stripped;
+        MemorySource tagged;
+        size_t added = 0;
+        if (!loadVariants(files, fixture, stripped, tagged, &added)) {
+            checker.skip(name.c_str(), fixture);
+            continue;
+        }
+
+        const Analysis exact = analyzeMemory(stripped, MP3_MODE_EXACT_SCAN);
+        const Analysis fast = analyzeMemory(tagged, MP3_MODE_FAST_ESTIMATE);
+
+        // Интервал накрывает точную длительность, а прочитана малая доля файла
+        const mp3_duration_estimate_t& e = fast.estimate;
+        char detail[192];
+        std::snprintf(detail, sizeof(detail),
+                      "%s, mode %u, exact %u in [%u, %u] ms, %u points, data %llu/%llu, "
+                      "read %llu",
+                      mp3_error_string(fast.code), fast.info.mode, exact.info.duration_ms,
+                      e.low_ms, e.high_ms, e.sample_points,
+                      (unsigned long long)fast.info.data_size,
+                      (unsigned long long)exact.info.data_size,
+                      (unsigned long long)fast.stats.bytes_returned);
+        checker.expect(name.c_str(),
+                       exact.code == MP3_OK && fast.code == MP3_OK &&
+                           fast.info.mode == MP3_MODE_FAST_ESTIMATE && e.sample_points > 0 &&
+                           e.duration_ms == fast.info.duration_ms &&
+                           e.low_ms <= exact.info.duration_ms &&
+                           exact.info.duration_ms <= e.high_ms &&
+                           fast.info.data_size == exact.info.data_size &&
+                           fast.stats.bytes_returned < exact.info.data_size / 64,
+                       detail);
+    }
+}
+
+// ============================================================================
+// Параллельный точный подсчёт
+// ============================================================================
+
+struct CountingParallelFor {
+    mp3::ParallelFor pool{4};
+    std::atomic<uint32_t> calls{0};
+
+    static void run(void* ctx, uint32_t count, mp3_task_fn task, void* taskCtx) {
+        auto* self = static_cast<CountingParallelFor*>(ctx);
+        self->calls.fetch_add(1, std::memory_order_relaxed);
+        self->pool.run(count, task, taskCtx);
+    }
+};
+
+void checkParallelScan(Checker& checker, Library& library) {
+    const char* name = "parallel: exact scan equals mp3_session_run";
+    if (library.entries.empty()) {
+        checker.skip(name, "files");
+        return;
+    }
+
+    CountingParallelFor parallel;
+    std::string mismatch;
+    uint32_t split = 0;
+    uint32_t large = 0;
+    for (const auto& entry : library.entries) {
+        large += entry.source->bytes.size() > MP3_NATIVE_PARALLEL_MIN_BYTES;
+        mp3_host_api_t api = entry.source->hostApi();
+        api.parallel_for = &CountingParallelFor::run;
+        api.parallel_ctx = &parallel;
+
+        const uint32_t before = parallel.calls.load();
+        mp3_session_t* session = nullptr;
+        mp3_audio_info_t info{};
+        mp3_result_t code = mp3_session_init(mp3_detector_instance(), &api, &session);
+        if (code == MP3_OK) {
+            mp3_analyze_options_t options{};
+            options.mode = MP3_MODE_EXACT_SCAN;
+            code = mp3_session_run_ex(session, &options, &info);
+            mp3_session_deinit(session);
+        }
+        split += parallel.calls.load() != before;
+        if (mismatch.empty()) {
+            mismatch = describeMismatch(entry, 2, code, info);
+        }
+    }
+
+    // Без файлов крупнее порога делить нечего: расхождение — провал,
+    // иначе проверка пропускается. Крупный файл обязан делиться
+    if (mismatch.empty() && large == 0) {
+        checker.skip(name, "file large enough to split");
+        return;
+    }
+    char detail[256];
+    std::snprintf(detail, sizeof(detail), "%s%s%u of %u large files split", mismatch.c_str(),
+                  mismatch.empty() ? "" : "; ", split, large);
+    checker.expect(name, mismatch.empty() && (large == 0 || split > 0), detail);
+}
+
+// ============================================================================
+// Асинхронный анализ: read_submit / mp3_session_complete
+// ============================================================================
+
+/**
+ * Хост read_submit без потоков: чтение ставится в очередь и завершается
+ * из цикла checkAsyncRun, а каждое третье — прямо внутри read_submit.
+ */
+struct QueuedReads {
+    MemorySource* source = nullptr;
+    uint32_t submitted = 0;
+    bool pending = false;
+    uint64_t offset = 0;
+    uint8_t* dst = nullptr;
+    size_t requested = 0;
+
+    static mp3_result_t submit(void* ctx, uint64_t offset, uint8_t* dst, size_t requested,
+                               mp3_session_t* session) {
+        auto* self = static_cast<QueuedReads*>(ctx);
+        if (++self->submitted % 3 == 0) {
+            size_t n = 0;
+            const mp3_result_t code =
+                MemorySource::readAt(self->source, offset, dst, requested, &n);
+            mp3_audio_info_t ignored;
+            mp3_session_complete(session, code, n, &ignored);
+            return MP3_OK;
+        }
+        self->pending = true;
+        self->offset = offset;
+        self->dst = dst;
+        self->requested = requested;
+        return MP3_OK;
+    }
+};
+
+void checkAsyncRun(Checker& checker, Library& library) {
+    const char* name = "async: run_async/complete equals mp3_session_run";
+    if (library.entries.empty()) {
+        checker.skip(name, "files");
+        return;
+    }
+
+    std::string mismatch;
+    uint32_t submitted = 0;
+    for (const auto& entry : library.entries) {
+        for (size_t m = 0; m < 3; ++m) {
+            QueuedReads reads;
+            reads.source = entry.source.get();
+            mp3_host_api_t api = entry.source->hostApi();
+            api.user_ctx = &reads;
+            api.read_at = nullptr;
+            api.read_submit = &QueuedReads::submit;
+
+            mp3_session_t* session = nullptr;
+            mp3_audio_info_t info{};
+            mp3_result_t code = mp3_session_init(mp3_detector_instance(), &api, &session);
+            if (code == MP3_OK) {
+                mp3_analyze_options_t options{};
+                options.mode = kModes[m];
+                code = mp3_session_run_async(session, &options, &info);
+                while (code == MP3_ERR_PENDING && reads.pending) {
+                    reads.pending = false;
+                    size_t n = 0;
+                    const mp3_result_t readCode = MemorySource::readAt(
+                        entry.source.get(), reads.offset, reads.dst, reads.requested, &n);
+                    code = mp3_session_complete(session, readCode, n, &info);
+                }
+                mp3_session_deinit(session);
+            }
+            submitted += reads.submitted;
+            if (mismatch.empty()) {
+                mismatch = describeMismatch(entry, m, code, info);
+            }
+        }
+    }
+
+    char detail[256];
+    std::snprintf(detail, sizeof(detail), "%s%s%u reads submitted", mismatch.c_str(),
+                  mismatch.empty() ? "" : "; ", submitted);
+    checker.expect(name, mismatch.empty() && submitted > 0, detail);
+}
+
+// ============================================================================
+// Анализ по шагам с малым бюджетом
+// ============================================================================
+
+void checkSteppedRun(Checker& checker, Library& library) {
+    const char* name = "step: 1-byte budget equals mp3_session_run";
+    if (library.entries.empty()) {
+        checker.skip(name, "files");
+        return;
+    }
+
+    std::string mismatch;
+    uint32_t maxSteps = 0;
+    for (const auto& entry : library.entries) {
+        for (size_t m = 0; m < 3; ++m) {
+            const mp3_host_api_t api = entry.source->hostApi();
+            mp3_session_t* session = nullptr;
+            mp3_audio_info_t info{};
+            mp3_result_t code = mp3_session_init(mp3_detector_instance(), &api, &session);
+            if (code == MP3_OK) {
+                mp3_analyze_options_t options{};
+                options.mode = kModes[m];
+                code = mp3_session_begin(session, &options);
+                uint8_t done = 0;
+                // Бюджет 1 байт — одно окно чтения за шаг
+                while (code == MP3_OK && !done) {
+                    code = mp3_session_step(session, 1, &done, &info);
+                }
+                mp3_session_stats_t stats{};
+                mp3_session_get_stats(session, &stats);
+                maxSteps = std::max(maxSteps, stats.steps);
+                mp3_session_deinit(session);
+            }
+            if (mismatch.empty()) {
+                mismatch = describeMismatch(entry, m, code, info);
+            }
+        }
+    }
+
+    char detail[256];
+    std::snprintf(detail, sizeof(detail), "%s%sup to %u steps", mismatch.c_str(),
+                  mismatch.empty() ? "" : "; ", maxSteps);
+    checker.expect(name, mismatch.empty() && maxSteps > 1, detail);
+}
+
+// ============================================================================
+// Push-анализ: mp3_stream_feed кусками неровного размера
+// ============================================================================
+
+void checkStreamFeed(Checker& checker, Library& library) {
+    const char* name = "stream: odd-sized feeds equal mp3_session_run";
+    if (library.entries.empty()) {
+        checker.skip(name, "files");
+        return;
+    }
+
+    // Куски меньше заголовка, не кратные окну и больше него
+    const size_t chunks[] = {1, 7, 4093, 13, 65537, 333};
+    std::string mismatch;
+    uint64_t fed = 0;
+    for (const auto& entry : library.entries) {
+        for (size_t m = 0; m < 3; ++m) {
+            // Поток не знает размера источника: эталон — run с source_size = 0
+            mp3_host_api_t api = entry.source->hostApi();
+            api.source_size = 0;
+            mp3_analyze_options_t options{};
+            options.mode = kModes[m];
+            mp3_audio_info_t expected{};
+            const mp3_result_t expectedCode =
+                mp3_analyze_ex(mp3_detector_instance(), &api, &options, &expected);
+
+            api.read_at = nullptr;
+            mp3_session_t* session = nullptr;
+            mp3_audio_info_t info{};
+            mp3_result_t code = mp3_session_init(mp3_detector_instance(), &api, &session);
+            if (code == MP3_OK) {
+                code = mp3_stream_begin(session, &options);
+                const std::vector<uint8_t>& bytes = entry.source->bytes;
+                for (size_t pos = 0, i = 0; code == MP3_OK && pos < bytes.size(); ++i) {
+                    const size_t len = std::min(chunks[i % 6], bytes.size() - pos);
+                    code = mp3_stream_feed(session, bytes.data() + pos, len, nullptr);
+                    pos += len;
+                    fed++;
+                }
+                if (code == MP3_OK) {
+                    code = mp3_stream_finish(session, &info);
+                }
+                mp3_session_deinit(session);
+            }
+            if (mismatch.empty() && (code != expectedCode || !sameInfo(info, expected))) {
+                char text[192];
+                std::snprintf(text, sizeof(text),
+                              "%s mode %u: %s %u ms (mode %u) vs %s %u ms (mode %u)",
+                              entry.name.c_str(), kModes[m], mp3_error_string(code),
+                              info.duration_ms, info.mode, mp3_error_string(expectedCode),
+                              expected.duration_ms, expected.mode);
+                mismatch = text;
+            }
+        }
+    }
+
+    char detail[256];
+    std::snprintf(detail, sizeof(detail), "%s%s%llu feeds", mismatch.c_str(),
+                  mismatch.empty() ? "" : "; ", (unsigned long long)fed);
+    checker.expect(name, mismatch.empty(), detail);
+}
+
+// ============================================================================
+// Отмена и крайний срок
+// ============================================================================
+
+/// read_at, который на cancelAt-м чтении отменяет собственную сессию
+struct CancellingReads {
+    MemorySource* source = nullptr;
+    mp3_session_t* session = nullptr;
+    uint32_t cancelAt = 0;
+    uint32_t reads = 0;
+
+    static mp3_result_t readAt(void* ctx, uint64_t offset, uint8_t* dst, size_t requested,
+                               size_t* out_read) {
+        auto* self = static_cast<CancellingReads*>(ctx);
+        if (++self->reads == self->cancelAt) {
+            mp3_session_cancel(self->session);
+        }
+        return MemorySource::readAt(self->source, offset, dst, requested, out_read);
+    }
+};
+
+void checkCancel(Checker& checker, const std::vector<fs::path>& files) {
+    const char* fixture = "test_2h_32vbr_stereo_44k1.mp3";
+    const char* name = "cancel: interrupted, sticky until reset";
+    MemorySource source;
+    mp3_audio_info_t reference;
+    if (!loadReference(checker, name, files, fixture, source, reference)) {
+        return;
+    }
+    const mp3_audio_info_t expected = analyzeMemory(source, MP3_MODE_EXACT_SCAN).info;
+
+    CancellingReads reads;
+    reads.source = &source;
+    reads.cancelAt = 20;
+    mp3_host_api_t api = source.hostApi();
+    api.user_ctx = &reads;
+    api.read_at = &CancellingReads::readAt;
+    if (mp3_session_init(mp3_detector_instance(), &api, &reads.session) != MP3_OK) {
+        checker.expect(name, false, "mp3_session_init failed");
+        return;
+    }
+    mp3_session_t* session = reads.session;
+    mp3_analyze_options_t options{};
+    options.mode = MP3_MODE_EXACT_SCAN;
+
+    // Отмена посреди точного подсчёта: код и оценка по разобранному
+    mp3_audio_info_t interrupted{};
+    const mp3_result_t cancelled = mp3_session_run_ex(session, &options, &interrupted);
+    const uint32_t readsAtCancel = reads.reads;
+
+    // Отмена до запуска не теряется: анализ прерывается, не начав читать
+    reads.reads = 0;
+    mp3_audio_info_t early{};
+    const mp3_result_t sticky = mp3_session_run_ex(session, &options, &early);
+    const uint32_t readsSticky = reads.reads;
+
+    // reset снимает отмену
+    reads.reads = 0;
+    reads.cancelAt = 0;
+    mp3_audio_info_t info{};
+    mp3_result_t code = mp3_session_reset(session, &api);
+    if (code == MP3_OK) {
+        code = mp3_session_run_ex(session, &options, &info);
+    }
+    mp3_session_deinit(session);
+
+    char detail[192];
+    std::snprintf(detail, sizeof(detail),
+                  "%s after %u reads (valid %u, mode %u), then %s after %u reads, "
+                  "after reset %s %u/%u ms",
+                  mp3_error_string(cancelled), readsAtCancel, interrupted.valid,
+                  interrupted.mode, mp3_error_string(sticky), readsSticky,
+                  mp3_error_string(code), info.duration_ms, expected.duration_ms);
+    checker.expect(name,
+                   cancelled == MP3_ERR_CANCELLED && readsAtCancel == 20 &&
+                       interrupted.valid && interrupted.mode == MP3_MODE_FAST_ESTIMATE &&
+                       sticky == MP3_ERR_CANCELLED && readsSticky == 0 && code == MP3_OK &&
+                       sameInfo(info, expected),
+                   detail);
+}
+
+/// Источник с часами, которые идут на 1 мкс за каждый вызов clock_us
+struct TickingSource {
+    MemorySource* source = nullptr;
+    uint64_t now = 1000;
+
+    static mp3_result_t readAt(void* ctx, uint64_t offset, uint8_t* dst, size_t requested,
+                               size_t* out_read) {
+        auto* self = static_cast<TickingSource*>(ctx);
+        return MemorySource::readAt(self->source, offset, dst, requested, out_read);
+    }
+
+    static uint64_t clockUs(void* ctx) {
+        return ++static_cast<TickingSource*>(ctx)->now;
+    }
+};
+
+void checkDeadline(Checker& checker, const std::vector<fs::path>& files) {
+    const char* fixture = "test_2h_32vbr_stereo_44k1.mp3";
+    const char* name = "deadline: expired deadline_us times out";
+    MemorySource source;
+    mp3_audio_info_t reference;
+    if (!loadReference(checker, name, files, fixture, source, reference)) {
+        return;
+    }
+    const mp3_audio_info_t expected = analyzeMemory(source, MP3_MODE_EXACT_SCAN).info;
+
+    mp3_analyze_options_t options{};
+    options.mode = MP3_MODE_EXACT_SCAN;
+    mp3_detector_t* detector = mp3_detector_instance();
+
+    // Срок без часов хоста — ошибка аргумента
+    mp3_host_api_t api = source.hostApi();
+    options.deadline_us = 1;
+    mp3_audio_info_t info{};
+    const mp3_result_t noClock = mp3_analyze_ex(detector, &api, &options, &info);
+
+    TickingSource ticking;
+    ticking.source = &source;
+    api.user_ctx = &ticking;
+    api.read_at = &TickingSource::readAt;
+    api.clock_us = &TickingSource::clockUs;
+
+    // Срок уже прошёл: ни одного фрейма, valid = 0
+    mp3_audio_info_t expired{};
+    const mp3_result_t expiredCode = mp3_analyze_ex(detector, &api, &options, &expired);
+
+    // Срок истекает посреди подсчёта: оценка по разобранному
+    options.deadline_us = ticking.now + 50;
+    mp3_audio_info_t midway{};
+    const mp3_result_t midwayCode = mp3_analyze_ex(detector, &api, &options, &midway);
+
+    // Далёкий срок анализу не мешает
+    options.deadline_us = ticking.now + 1000000000;
+    const mp3_result_t code = mp3_analyze_ex(detector, &api, &options, &info);
+
+    char detail[192];
+    std::snprintf(detail, sizeof(detail),
+                  "no clock %s, expired %s (valid %u), midway %s (valid %u, mode %u), "
+                  "far %s %u/%u ms",
+                  mp3_error_string(noClock), mp3_error_string(expiredCode), expired.valid,
+                  mp3_error_string(midwayCode), midway.valid, midway.mode,
+                  mp3_error_string(code), info.duration_ms, expected.duration_ms);
+    checker.expect(name,
+                   noClock == MP3_ERR_INVALID_ARG && expiredCode == MP3_ERR_TIMEOUT &&
+                       !expired.valid && midwayCode == MP3_ERR_TIMEOUT && midway.valid &&
+                       midway.mode == MP3_MODE_FAST_ESTIMATE && code == MP3_OK &&
+                       sameInfo(info, expected),
+                   detail);
+}
+
+// ============================================================================
+// Промежуточные результаты
+// ============================================================================
+
+/// Журнал вызовов progress; cancelAt-я оценка отменяет сессию
+struct ProgressLog {
+    mp3_session_t* session = nullptr;
+    uint32_t cancelAt = 0;
+    uint32_t estimates = 0;
+    uint32_t finals = 0;
+    uint32_t estimatesAfterFinal = 0;
+    mp3_audio_info_t final{};
+
+    static void on(void* ctx, const mp3_audio_info_t* info, uint8_t kind) {
+        auto* self = static_cast<ProgressLog*>(ctx);
+        if (kind == MP3_PROGRESS_FINAL) {
+            self->finals++;
+            self->final = *info;
+            return;
+        }
+        self->estimates++;
+        self->estimatesAfterFinal += self->finals > 0;
+        if (self->estimates == self->cancelAt) {
+            mp3_session_cancel(self->session);
+        }
+    }
+};
+
+/**
+ * По каждому файлу и режиму: результат тот же, что без progress, и байт
+ * прочитано столько же; FINAL ровно один и равен out_info, оценки — до
+ * него. Точный подсчёт (итог в режиме EXACT_SCAN) обязан дать хотя бы
+ * одну оценку, а итог по Xing (готов после первого окна) — ни одной.
+ */
+void checkProgress(Checker& checker, Library& library) {
+    const char* name = "progress: estimates, then one FINAL equal to run";
+    if (library.entries.empty()) {
+        checker.skip(name, "files");
+        return;
+    }
+
+    std::string detail;
+    for (auto& entry : library.entries) {
+        for (size_t m = 0; m < 3 && detail.empty(); ++m) {
+            ProgressLog log;
+            const Analysis plain = analyzeMemory(*entry.source, kModes[m]);
+            const Analysis a = analyzeMemory(*entry.source, kModes[m], &ProgressLog::on, &log);
+            detail = describeMismatch(entry, m, a.code, a.info);
+            if (!detail.empty()) {
+                break;
+            }
+            const bool counted = a.code == MP3_OK && a.info.mode == MP3_MODE_EXACT_SCAN;
+            const bool fromXing = a.code == MP3_OK && a.info.mode == MP3_MODE_TRUST_XING;
+            const bool ok = log.finals == (a.code == MP3_OK ? 1u : 0u) &&
+                            (log.finals == 0 || sameInfo(log.final, a.info)) &&
+                            log.estimatesAfterFinal == 0 && (!counted || log.estimates > 0) &&
+                            (!fromXing || log.estimates == 0) &&
+                            a.stats.bytes_returned == plain.stats.bytes_returned;
+            if (!ok) {
+                char text[192];
+                std::snprintf(text, sizeof(text),
+                              "%s mode %u: %u estimates, %u FINAL (%u ms vs %u ms), "
+                              "%llu vs %llu bytes",
+                              entry.name.c_str(), kModes[m], log.estimates, log.finals,
+                              log.final.duration_ms, a.info.duration_ms,
+                              static_cast<unsigned long long>(a.stats.bytes_returned),
+                              static_cast<unsigned long long>(plain.stats.bytes_returned));
+                detail = text;
+            }
+        }
+    }
+    checker.expect(name, detail.empty(), detail);
+}
+
+/// Ни ошибка формата, ни отмена из progress не дают FINAL
+void checkProgressFailure(Checker& checker, const std::vector<fs::path>& files) {
+    const char* fixture = "test_2h_32vbr_stereo_44k1.mp3";
+    const char* name = "progress: no FINAL on error or cancel";
+    MemorySource source;
+    mp3_audio_info_t reference;
+    if (!loadReference(checker, name, files, fixture, source, reference)) {
+        return;
+    }
+
+    // Нули вместо MPEG-данных
+    MemorySource garbage;
+    garbage.bytes.assign(256 * 1024, 0);
+    ProgressLog invalid;
+    const mp3_result_t invalidCode =
+        analyzeMemory(garbage, MP3_MODE_EXACT_SCAN, &ProgressLog::on, &invalid).code;
+
+    // Отмена на второй оценке, посреди точного подсчёта
+    ProgressLog cancelled;
+    cancelled.cancelAt = 2;
+    mp3_result_t cancelCode = MP3_ERR_UNKNOWN;
+    const mp3_host_api_t api = source.hostApi();
+    if (mp3_session_init(mp3_detector_instance(), &api, &cancelled.session) == MP3_OK) {
+        mp3_analyze_options_t options{};
+        options.mode = MP3_MODE_EXACT_SCAN;
+        options.progress = &ProgressLog::on;
+        options.progress_ctx = &cancelled;
+        mp3_audio_info_t info{};
+        cancelCode = mp3_session_run_ex(cancelled.session, &options, &info);
+        mp3_session_deinit(cancelled.session);
+    }
+
+    char detail[160];
+    std::snprintf(detail, sizeof(detail), "invalid: %s, %u FINAL; cancel: %s, %u FINAL",
+                  mp3_error_string(invalidCode), invalid.finals, mp3_error_string(cancelCode),
+                  cancelled.finals);
+    checker.expect(name,
+                   invalidCode == MP3_ERR_INVALID_FORMAT && invalid.finals == 0 &&
+                       cancelCode == MP3_ERR_CANCELLED && cancelled.finals == 0,
+                   detail);
+}
+
+// ============================================================================
+// Индекс длительностей: битый файл читается как пустой индекс
+// ============================================================================
+
+bool writeBytes(const fs::path& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(out);
+}
+
+void checkIndexCorruption(Checker& checker) {
+    const char* name = "index: truncated or inflated file loads empty";
+    const fs::path path = fs::temp_directory_path() /
+                          ("mp3_self_check_" + std::to_string(::getpid()) + ".m3di");
+
+    mp3::DurationIndex index;
+    for (uint64_t i = 1; i <= 3; ++i) {
+        mp3_audio_info_t info{};
+        info.duration_ms = static_cast<uint32_t>(i * 1000);
+        info.valid = 1;
+        index.put(mp3::IndexKey{i, i * 100, static_cast<int64_t>(i), 0}, MP3_OK, info);
+    }
+    std::vector<uint8_t> good;
+    if (!index.save(path.string()) || !loadFile(path, good) || good.size() < 12) {
+        checker.expect(name, false, "cannot write " + path.string());
+        fs::remove(path);
+        return;
+    }
+
+    // Обрезан посреди записи; счётчик записей ff ff ff ff и на одну больше
+    std::vector<uint8_t> truncated(good.begin(), good.end() - 10);
+    std::vector<uint8_t> inflated = good;
+    std::memset(&inflated[8], 0xFF, 4);
+    std::vector<uint8_t> oneMore = good;
+    oneMore[8]++;
+
+    std::string detail;
+    const struct {
+        const char* what;
+        const std::vector<uint8_t>* bytes;
+        bool loads;
+    } cases[] = {
+        {"intact", &good, true},
+        {"truncated", &truncated, false},
+        {"count ffffffff", &inflated, false},
+        {"count + 1", &oneMore, false},
+    };
+    for (const auto& c : cases) {
+        mp3::DurationIndex loaded;
+        const bool ok = writeBytes(path, *c.bytes) && loaded.load(path.string()) == c.loads &&
+                        loaded.size() == (c.loads ? 3u : 0u);
+        if (!ok && detail.empty()) {
+            detail = std::string(c.what) + ": " + std::to_string(loaded.size()) + " entries";
+        }
+    }
+    fs::remove(path);
+    checker.expect(name, detail.empty(), detail);
+}
+
+// ============================================================================
+// Наблюдатель: ссылка на каталог не даёт псевдонимов в журнале
+// ============================================================================
+
+void checkWatcherSymlinkLoop(Checker& checker) {
+    const char* name = "watcher: symlinked directory loop is not followed";
+    if (!mp3::DirectoryWatcher::supported()) {
+        checker.skip(name, "inotify");
+        return;
+    }
+    const fs::path root = fs::temp_directory_path() /
+                          ("mp3_self_check_" + std::to_string(::getpid()));
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "a", ec);
+    if (!ec) {
+        fs::create_directory_symlink(root, root / "a" / "loop", ec);
+    }
+    if (ec) {
+        checker.skip(name, "writable temp directory");
+        fs::remove_all(root, ec);
+        return;
+    }
+
+    // Петля a/loop -> root: при обходе по ссылке корень получил бы путь
+    // вида root/a/loop/a/loop/..., и новый файл попал бы в журнал под ним
+    const fs::path added = root / "new.mp3";
+    mp3::DirectoryWatcher watcher;
+    std::string detail;
+    if (!watcher.start(root.string())) {
+        detail = "start failed";
+    } else if (!writeBytes(added, std::vector<uint8_t>(16, 0))) {
+        detail = "cannot write " + added.string();
+    } else {
+        mp3::DirectoryChanges changes;
+        for (int i = 0; i < 10 && changes.modified.empty() && watcher.poll(100); ++i) {
+            changes = watcher.takeChanges();
+        }
+        if (changes.modified.size() != 1 || changes.modified[0] != added.string()) {
+            detail = std::to_string(changes.modified.size()) + " modified";
+            for (const auto& path : changes.modified) {
+                detail += ", " + path;
+            }
+        }
+    }
+    watcher.stop();
+    fs::remove_all(root, ec);
+    checker.expect(name, detail.empty(), detail);
+}
+
+} // namespace
+
+CheckTotals runSelfChecks(const std::vector<fs::path>& files) {
+    Checker checker;
+    checkSessionPool(checker, files);
+    checkSessionArena(checker, files);
+    checkTagSkipping(checker, files);
+    checkCbrVerified(checker, files);
+    checkSampledEstimate(checker, files);
+
+    Library library = loadLibrary(files);
+    checkParallelScan(checker, library);
+    checkAsyncRun(checker, library);
+    checkSteppedRun(checker, library);
+    checkStreamFeed(checker, library);
+    checkCancel(checker, files);
+    checkDeadline(checker, files);
+    checkProgress(checker, library);
+    checkProgressFailure(checker, files);
+    checkIndexCorruption(checker);
+    checkWatcherSymlinkLoop(checker);
+    return checker.totals();
+}
@@ -0,0 +1,30 @@
+/**
+ * @file self_checks.h
+ * @brief Самопроверки TestCppApp поверх файлов каталога
+ *
+ * Регрессии, которые не видны по таблице длительностей: конкуренция
+ * за пул и арену детектора, варианты файлов без Xing и с тегами,
+ * совпадение parallel / async / step / stream с mp3_session_run, отмена,
+ * срок и вызовы progress. Файлы ищутся по имени среди найденных; нет файла — проверка
+ * пропускается.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+#include <filesystem>
+#include <vector>
+
+struct CheckTotals {
+    int passed = 0;
+    int failed = 0;
+    int skipped = 0;
+};
+
+/**
+ * Прогнать самопроверки и напечатать по строке на каждую. Эталон —
+ * общий детектор (mp3_detector_instance); пул и арену проверки
+ * создают сами.
+ */
+CheckTotals runSelfChecks(const std::vector<std::filesystem::path>& files);
@@ -1,10 +1,16 @@
 //! mp3DurationDetectorRs — Rust-реализация парсера MP3
 //!
-//! Экспортирует три C-ABI функции, которые перекрывают weak-символы
+//! Экспортирует C-ABI функции, которые перекрывают weak-символы
 //! в mp3_lib.cpp и вызываются прокладкой автоматически:
 //!
+//! - `mp3_rust_session_storage_size_impl`
 //! - `mp3_rust_session_init_impl`
 //! - `mp3_rust_session_run_impl`
+//! - `mp3_rust_session_reset_impl`
+//! - `mp3_rust_session_get_stats_impl`
+//! - `mp3_rust_session_get_estimate_impl`
+//! - `mp3_rust_session_begin_impl` / `_step_impl` / `_pending_impl` / `_feed_impl` / `_finish_impl`
+//! - `mp3_rust_session_progress_impl`
 //! - `mp3_rust_session_deinit_impl`
 //!
 //! **Текущая реализация**: заглушки, возвращающие фиксированные значения.
@@ -24,8 +30,13 @@ const MP3_ERR_OUT_OF_MEMORY: i32 = 3;
 const MP3_ERR_IO: i32 = 4;
 #[allow(dead_code)]
 const MP3_ERR_INVALID_FORMAT: i32 = 5;
-#[allow(dead_code)]
 const MP3_ERR_NOT_IMPLEMENTED: i32 = 6;
+#[allow(dead_code)]
+const MP3_ERR_INTERNAL: i32 = 7;
+#[allow(dead_code)]
+const MP3_ERR_NOT_FOUND: i32 = 8;
+#[allow(dead_code)]
+const MP3_ERR_PENDING: i32 = 9;
 
 // =============================================================================
 // C-совместимые типы (зеркало mp3_lib.h)
@@ -41,6 +52,19 @@ pub struct Mp3AudioInfo {
     pub duration_ms: u32,
     pub data_size: u64,
     pub valid: u8,
+    pub mode: u8,
+}
+
+/// Тип callback промежуточного результата — зеркало mp3_progress_fn
+type ProgressFn = unsafe extern "C" fn(progress_ctx: *mut c_void, info: *const Mp3AudioInfo, kind: u8);
+
+/// Параметры запуска — зеркало mp3_analyze_options_t
+#[repr(C)]
+pub struct Mp3AnalyzeOptions {
+    pub mode: u8,
+    pub progress: Option<ProgressFn>,
+    pub progress_ctx: *mut c_void,
+    pub deadline_us: u64,
 }
 
 /// Тип callback чтения — зеркало mp3_read_at_fn
@@ -52,6 +76,38 @@ type ReadAtFn = unsafe extern "C" fn(
     out_read: *mut usize,
 ) -> i32;
 
+/// Тип callback чтения без копирования — зеркало mp3_borrow_at_fn
+type BorrowAtFn = unsafe extern "C" fn(
+    user_ctx: *mut c_void,
+    offset: u64,
+    requested: usize,
+    out_data: *mut *const u8,
+    out_len: *mut usize,
+) -> i32;
+
+/// Тип callback часов — зеркало mp3_clock_us_fn
+type ClockUsFn = unsafe extern "C" fn(user_ctx: *mut c_void) -> u64;
+
+/// Тип задачи — зеркало mp3_task_fn
+type TaskFn = unsafe extern "C" fn(task_ctx: *mut c_void, index: u32);
+
+/// Тип параллельного цикла хоста — зеркало mp3_parallel_for_fn
+type ParallelForFn = unsafe extern "C" fn(
+    parallel_ctx: *mut c_void,
+    count: u32,
+    task: Option<TaskFn>,
+    task_ctx: *mut c_void,
+);
+
+/// Тип асинхронного чтения — зеркало mp3_read_submit_fn
+type ReadSubmitFn = unsafe extern "C" fn(
+    user_ctx: *mut c_void,
+    offset: u64,
+    dst: *mut u8,
+    requested: usize,
+    session: *mut c_void,
+) -> i32;
+
 /// Тип callback аллокации
 type AllocFn = unsafe extern "C" fn(user_ctx: *mut c_void, size: usize) -> *mut c_void;
 
@@ -70,6 +126,38 @@ pub struct Mp3HostApi {
     pub alloc: Option<AllocFn>,
     pub free: Option<FreeFn>,
     pub log: Option<LogFn>,
+    pub read_ahead: u32,
+    pub borrow_at: Option<BorrowAtFn>,
+    pub clock_us: Option<ClockUsFn>,
+    pub parallel_for: Option<ParallelForFn>,
+    pub parallel_ctx: *mut c_void,
+    pub read_submit: Option<ReadSubmitFn>,
+}
+
+/// Статистика сессии — зеркало mp3_session_stats_t
+#[repr(C)]
+pub struct Mp3SessionStats {
+    pub read_calls: u32,
+    pub max_request: u32,
+    pub bytes_requested: u64,
+    pub bytes_returned: u64,
+    pub frames_inspected: u64,
+    pub id3_bytes_skipped: u64,
+    pub phase_us: [u64; 4],
+    pub total_us: u64,
+    pub steps: u32,
+    pub max_step_us: u64,
+}
+
+/// Точность длительности — зеркало mp3_duration_estimate_t
+#[repr(C)]
+pub struct Mp3DurationEstimate {
+    pub duration_ms: u32,
+    pub error_ms: u32,
+    pub low_ms: u32,
+    pub high_ms: u32,
+    pub sample_points: u32,
+    pub sampled_frames: u32,
 }
 
 // =============================================================================
@@ -85,27 +173,41 @@ struct RustSession {
 // Экспортируемые FFI-функции (перекрывают weak-символы в mp3_lib.cpp)
 // =============================================================================
 
-/// Инициализация Rust-сессии
+/// Выравнивание памяти сессии — зеркало MP3_SESSION_STORAGE_ALIGN
+const MP3_SESSION_STORAGE_ALIGN: usize = 8;
+
+const _: () = assert!(core::mem::align_of::<RustSession>() <= MP3_SESSION_STORAGE_ALIGN);
+
+/// Сколько байт памяти прокладка должна отдать под Rust-сессию
+#[no_mangle]
+pub extern "C" fn mp3_rust_session_storage_size_impl() -> usize {
+    core::mem::size_of::<RustSession>()
+}
+
+/// Инициализация Rust-сессии в памяти, выделенной прокладкой
 ///
 /// # Safety
-/// Вызывается из C/C++. Указатели должны быть валидны.
+/// Вызывается из C/C++. Указатели должны быть валидны, storage —
+/// не меньше `mp3_rust_session_storage_size_impl()` байт и выровнен.
 #[no_mangle]
 pub unsafe extern "C" fn mp3_rust_session_init_impl(
+    storage: *mut c_void,
     host_api: *const Mp3HostApi,
     out_rust_session: *mut *mut c_void,
 ) -> i32 {
-    if host_api.is_null() || out_rust_session.is_null() {
+    if storage.is_null() || host_api.is_null() || out_rust_session.is_null() {
         return MP3_ERR_INVALID_PTR;
     }
 
     // Копируем host_api (POD-структура) для хранения в сессии
     let api_copy = core::ptr::read(host_api);
 
-    let session = Box::new(RustSession {
+    let session = storage as *mut RustSession;
+    core::ptr::write(session, RustSession {
         _host_api: api_copy,
     });
 
-    *out_rust_session = Box::into_raw(session) as *mut c_void;
+    *out_rust_session = session as *mut c_void;
     MP3_OK
 }
 
@@ -118,9 +220,10 @@ pub unsafe extern "C" fn mp3_rust_session_init_impl(
 #[no_mangle]
 pub unsafe extern "C" fn mp3_rust_session_run_impl(
     rust_session: *mut c_void,
+    options: *const Mp3AnalyzeOptions,
     out_info: *mut Mp3AudioInfo,
 ) -> i32 {
-    if rust_session.is_null() || out_info.is_null() {
+    if rust_session.is_null() || options.is_null() || out_info.is_null() {
         return MP3_ERR_INVALID_PTR;
     }
 
@@ -141,18 +244,181 @@ pub unsafe extern "C" fn mp3_rust_session_run_impl(
         duration_ms: 1000, // stub: всегда 1 секунда
         data_size: 0,
         valid: 1,
+        mode: (*options).mode,
     };
 
     MP3_OK
 }
 
-/// Завершить сессию и освободить память
+/// Перенастроить сессию на новый источник
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_reset_impl(
+    rust_session: *mut c_void,
+    host_api: *const Mp3HostApi,
+) -> i32 {
+    if rust_session.is_null() || host_api.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    let session = &mut *(rust_session as *mut RustSession);
+    session._host_api = core::ptr::read(host_api);
+    MP3_OK
+}
+
+/// Счётчики разбора последнего run
+///
+/// **STUB**: заглушка не ведёт счётчиков; поля ввода-вывода заполняет прокладка.
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_get_stats_impl(
+    rust_session: *mut c_void,
+    out_stats: *mut Mp3SessionStats,
+) -> i32 {
+    if rust_session.is_null() || out_stats.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    MP3_ERR_NOT_IMPLEMENTED
+}
+
+/// Точность длительности последнего run
+///
+/// **STUB**: заглушка интервал не считает.
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_get_estimate_impl(
+    rust_session: *mut c_void,
+    out_estimate: *mut Mp3DurationEstimate,
+) -> i32 {
+    if rust_session.is_null() || out_estimate.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    MP3_ERR_NOT_IMPLEMENTED
+}
+
+/// Начать анализ по шагам (асинхронный режим прокладки)
+///
+/// **STUB**: по шагам заглушка не работает: `mp3_session_begin` вернёт
+/// `MP3_ERR_NOT_IMPLEMENTED`, `mp3_session_run_async` откатится
+/// к блокирующему `mp3_rust_session_run_impl`.
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_begin_impl(
+    rust_session: *mut c_void,
+    options: *const Mp3AnalyzeOptions,
+) -> i32 {
+    if rust_session.is_null() || options.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    MP3_ERR_NOT_IMPLEMENTED
+}
+
+/// Шаг анализа с бюджетом `budget_bytes`; `*out_done = 1` — закончен
+///
+/// **STUB**: по шагам заглушка не работает.
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_step_impl(
+    rust_session: *mut c_void,
+    _budget_bytes: u32,
+    out_done: *mut u8,
+) -> i32 {
+    if rust_session.is_null() || out_done.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    *out_done = 1;
+    MP3_ERR_NOT_IMPLEMENTED
+}
+
+/// Следующее чтение анализа по шагам: `MP3_ERR_PENDING` — прочитать,
+/// `MP3_OK` — анализ закончен
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_pending_impl(
+    rust_session: *mut c_void,
+    out_offset: *mut u64,
+    out_dst: *mut *mut u8,
+    out_size: *mut usize,
+) -> i32 {
+    if rust_session.is_null() || out_offset.is_null() || out_dst.is_null() || out_size.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    MP3_OK
+}
+
+/// Результат чтения, запрошенного `mp3_rust_session_pending_impl`
+///
+/// # Safety
+/// Вызывается из C/C++.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_feed_impl(
+    rust_session: *mut c_void,
+    _read_result: i32,
+    _read_len: usize,
+) -> i32 {
+    if rust_session.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    MP3_ERR_NOT_IMPLEMENTED
+}
+
+/// Итог анализа по шагам
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_finish_impl(
+    rust_session: *mut c_void,
+    out_info: *mut Mp3AudioInfo,
+) -> i32 {
+    if rust_session.is_null() || out_info.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    MP3_ERR_NOT_IMPLEMENTED
+}
+
+/// Промежуточный результат (push-режим)
+///
+/// # Safety
+/// Вызывается из C/C++. Указатели должны быть валидны.
+#[no_mangle]
+pub unsafe extern "C" fn mp3_rust_session_progress_impl(
+    rust_session: *mut c_void,
+    out_info: *mut Mp3AudioInfo,
+) -> i32 {
+    if rust_session.is_null() || out_info.is_null() {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    MP3_ERR_NOT_IMPLEMENTED
+}
+
+/// Завершить сессию; память принадлежит прокладке и не освобождается
 ///
 /// # Safety
 /// Вызывается из C/C++.
 #[no_mangle]
 pub unsafe extern "C" fn mp3_rust_session_deinit_impl(rust_session: *mut c_void) {
     if !rust_session.is_null() {
-        let _ = Box::from_raw(rust_session as *mut RustSession);
+        core::ptr::drop_in_place(rust_session as *mut RustSession);
     }
 }
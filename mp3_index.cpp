@@ -0,0 +1,231 @@
+/**
+ * @file mp3_index.cpp
+ * @brief Бинарный индекс длительностей: проверка заголовка и поиск
+ *
+ * Поля читаются побайтно, поэтому образ не обязан быть выровнен,
+ * а порядок байт процессора не важен.
+ */
+
+#include "mp3_index.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 32;
+
+static_assert(sizeof(mp3_index_entry_t) == MP3_INDEX_ENTRY_SIZE,
+              "mp3_index_entry_t must match the on-disk entry");
+static_assert(sizeof(mp3_index_header_t) == HEADER_SIZE,
+              "mp3_index_header_t must match the on-disk header");
+static_assert(MP3_INDEX_SECTOR_SIZE % MP3_INDEX_ENTRY_SIZE == 0,
+              "entries must not straddle sectors");
+
+uint16_t get16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t get64(const uint8_t* p) {
+    return static_cast<uint64_t>(get32(p)) | (static_cast<uint64_t>(get32(p + 4)) << 32);
+}
+
+void put16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+void put64(uint8_t* p, uint64_t v) {
+    put32(p, static_cast<uint32_t>(v));
+    put32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+void decode_entry(const uint8_t* p, mp3_index_entry_t* out) {
+    out->path_hash = get64(p);
+    out->file_size = get64(p + 8);
+    out->duration_ms = get32(p + 16);
+    out->bitrate = get32(p + 20);
+    out->sample_rate = get32(p + 24);
+    out->channels = p[28];
+    out->mode = p[29];
+    out->valid = p[30];
+    out->code = p[31];
+}
+
+/// Проверить заголовок; file_size 0 — длина неизвестна
+mp3_result_t open_header(const uint8_t* h, uint64_t file_size, mp3_index_t* out) {
+    if (std::memcmp(h, MP3_INDEX_MAGIC, 4) != 0 ||
+        get16(h + 4) != MP3_INDEX_VERSION ||
+        get16(h + 6) != MP3_INDEX_ENTRY_SIZE) {
+        return MP3_ERR_INVALID_FORMAT;
+    }
+
+    const uint32_t count = get32(h + 8);
+    const uint32_t offset = get32(h + 12);
+    if (offset < HEADER_SIZE) {
+        return MP3_ERR_INVALID_FORMAT;
+    }
+    if (file_size &&
+        uint64_t(offset) + uint64_t(count) * MP3_INDEX_ENTRY_SIZE > file_size) {
+        return MP3_ERR_INVALID_FORMAT;
+    }
+
+    out->entry_count = count;
+    out->entries_offset = offset;
+    return MP3_OK;
+}
+
+} // namespace
+
+extern "C" {
+
+uint64_t mp3_index_hash_path(const char* path) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    if (path) {
+        for (const char* c = path; *c; ++c) {
+            hash = (hash ^ static_cast<uint8_t>(*c)) * 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+mp3_result_t mp3_index_open_image(const void* image, size_t image_size, mp3_index_t* out_index) {
+    if (!image || !out_index) {
+        return MP3_ERR_INVALID_PTR;
+    }
+    if (image_size < HEADER_SIZE) {
+        return MP3_ERR_INVALID_FORMAT;
+    }
+    return open_header(static_cast<const uint8_t*>(image), image_size, out_index);
+}
+
+mp3_result_t mp3_index_find_image(
+    const void* image,
+    const mp3_index_t* index,
+    uint64_t path_hash,
+    mp3_index_entry_t* out_entry
+) {
+    if (!image || !index || !out_entry) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    const uint8_t* entries = static_cast<const uint8_t*>(image) + index->entries_offset;
+    uint32_t lo = 0;
+    uint32_t hi = index->entry_count;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const uint8_t* e = entries + size_t(mid) * MP3_INDEX_ENTRY_SIZE;
+        const uint64_t hash = get64(e);
+        if (hash == path_hash) {
+            decode_entry(e, out_entry);
+            return MP3_OK;
+        }
+        if (hash < path_hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return MP3_ERR_NOT_FOUND;
+}
+
+mp3_result_t mp3_index_open(
+    mp3_read_at_fn read_at,
+    void* user_ctx,
+    uint64_t source_size,
+    mp3_index_t* out_index
+) {
+    if (!read_at || !out_index) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    size_t got = 0;
+    const mp3_result_t result = read_at(user_ctx, 0, header, sizeof(header), &got);
+    if (result != MP3_OK) {
+        return result;
+    }
+    if (got < sizeof(header)) {
+        return MP3_ERR_INVALID_FORMAT;
+    }
+    return open_header(header, source_size, out_index);
+}
+
+mp3_result_t mp3_index_find(
+    mp3_read_at_fn read_at,
+    void* user_ctx,
+    const mp3_index_t* index,
+    uint64_t path_hash,
+    mp3_index_entry_t* out_entry
+) {
+    if (!read_at || !index || !out_entry) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    uint8_t e[MP3_INDEX_ENTRY_SIZE];
+    uint32_t lo = 0;
+    uint32_t hi = index->entry_count;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        size_t got = 0;
+        const mp3_result_t result = read_at(
+            user_ctx, index->entries_offset + uint64_t(mid) * MP3_INDEX_ENTRY_SIZE,
+            e, sizeof(e), &got);
+        if (result != MP3_OK) {
+            return result;
+        }
+        if (got < sizeof(e)) {
+            return MP3_ERR_INVALID_FORMAT;
+        }
+
+        const uint64_t hash = get64(e);
+        if (hash == path_hash) {
+            decode_entry(e, out_entry);
+            return MP3_OK;
+        }
+        if (hash < path_hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return MP3_ERR_NOT_FOUND;
+}
+
+void mp3_index_encode_header(const mp3_index_header_t* header, uint8_t* out) {
+    std::memset(out, 0, HEADER_SIZE);
+    std::memcpy(out, header->magic, 4);
+    put16(out + 4, header->version);
+    put16(out + 6, header->entry_size);
+    put32(out + 8, header->entry_count);
+    put32(out + 12, header->entries_offset);
+    put64(out + 16, header->created_unix);
+    put64(out + 24, header->reserved);
+}
+
+void mp3_index_encode_entry(const mp3_index_entry_t* entry, uint8_t* out) {
+    put64(out, entry->path_hash);
+    put64(out + 8, entry->file_size);
+    put32(out + 16, entry->duration_ms);
+    put32(out + 20, entry->bitrate);
+    put32(out + 24, entry->sample_rate);
+    out[28] = entry->channels;
+    out[29] = entry->mode;
+    out[30] = entry->valid;
+    out[31] = entry->code;
+}
+
+} // extern "C"
@@ -0,0 +1,134 @@
+/**
+ * @file mp3_index.h
+ * @brief Бинарный индекс длительностей для прошивки (поиск без разбора файлов)
+ *
+ * Хост заранее строит индекс по каталогу (mp3::FirmwareIndexWriter из
+ * HostLib), прошивка при загрузке находит в нём длительность файла по хэшу
+ * его пути и не разбирает карту целиком.
+ *
+ * Формат фиксированный, little-endian, версия MP3_INDEX_VERSION:
+ *  - сектор 0 (512 байт): mp3_index_header_t, остальное — нули;
+ *  - с MP3_INDEX_ENTRIES_OFFSET: mp3_index_entry_t по возрастанию path_hash,
+ *    по 16 записей на сектор, запись не пересекает границу сектора.
+ * Ключ — FNV-1a 64 пути от корня библиотеки с '/' (mp3_index_hash_path),
+ * т.е. так, как путь видит прошивка, а не хост. Пути с одинаковым хэшем
+ * в индекс не попадают — такие файлы прошивка разбирает сама.
+ *
+ * Поиск — двоичный, без аллокаций и разбора: по образу в памяти (mmap,
+ * XIP-флеш) или через mp3_read_at_fn по одной записи за чтение.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MP3_INDEX_MAGIC "M3IX"
+#define MP3_INDEX_VERSION 1u
+#define MP3_INDEX_SECTOR_SIZE 512u
+#define MP3_INDEX_ENTRIES_OFFSET MP3_INDEX_SECTOR_SIZE
+#define MP3_INDEX_ENTRY_SIZE 32u
+
+/**
+ * @brief Заголовок индекса (32 байта в начале файла)
+ */
+typedef struct {
+    char magic[4];                  ///< MP3_INDEX_MAGIC
+    uint16_t version;               ///< MP3_INDEX_VERSION
+    uint16_t entry_size;            ///< MP3_INDEX_ENTRY_SIZE
+    uint32_t entry_count;
+    uint32_t entries_offset;        ///< MP3_INDEX_ENTRIES_OFFSET
+    uint64_t created_unix;          ///< Когда построен (секунды), для диагностики
+    uint64_t reserved;
+} mp3_index_header_t;
+
+/**
+ * @brief Запись индекса (32 байта)
+ *
+ * file_size — размер файла на момент построения: если он не совпал
+ * с размером на карте, запись устарела и файл надо разобрать.
+ */
+typedef struct {
+    uint64_t path_hash;             ///< mp3_index_hash_path()
+    uint64_t file_size;
+    uint32_t duration_ms;
+    uint32_t bitrate;
+    uint32_t sample_rate;
+    uint8_t channels;
+    uint8_t mode;                   ///< mp3_analyze_mode_t
+    uint8_t valid;                  ///< Как mp3_audio_info_t::valid
+    uint8_t code;                   ///< mp3_result_t разбора на хосте
+} mp3_index_entry_t;
+
+/**
+ * @brief Открытый индекс: проверенный заголовок
+ */
+typedef struct {
+    uint32_t entry_count;
+    uint32_t entries_offset;
+} mp3_index_t;
+
+/**
+ * @brief FNV-1a 64 пути (байты как есть, до завершающего нуля)
+ */
+uint64_t mp3_index_hash_path(const char* path);
+
+/**
+ * @brief Проверить заголовок образа индекса в памяти
+ * @return MP3_ERR_INVALID_FORMAT — не индекс, другая версия или образ обрезан
+ */
+mp3_result_t mp3_index_open_image(const void* image, size_t image_size, mp3_index_t* out_index);
+
+/**
+ * @brief Найти запись в образе, открытом mp3_index_open_image
+ * @return MP3_OK или MP3_ERR_NOT_FOUND
+ */
+mp3_result_t mp3_index_find_image(
+    const void* image,
+    const mp3_index_t* index,
+    uint64_t path_hash,
+    mp3_index_entry_t* out_entry
+);
+
+/**
+ * @brief Проверить заголовок индекса, читая через read_at
+ *
+ * @param source_size Размер файла индекса (0 — не проверять длину)
+ */
+mp3_result_t mp3_index_open(
+    mp3_read_at_fn read_at,
+    void* user_ctx,
+    uint64_t source_size,
+    mp3_index_t* out_index
+);
+
+/**
+ * @brief Найти запись, читая по MP3_INDEX_ENTRY_SIZE байт за раз
+ *
+ * Не больше log2(entry_count) + 1 чтений; буфер — 32 байта на стеке.
+ * @return MP3_OK, MP3_ERR_NOT_FOUND или ошибка read_at
+ */
+mp3_result_t mp3_index_find(
+    mp3_read_at_fn read_at,
+    void* user_ctx,
+    const mp3_index_t* index,
+    uint64_t path_hash,
+    mp3_index_entry_t* out_entry
+);
+
+/**
+ * @brief Записать заголовок в 32 байта little-endian (для писателя индекса)
+ */
+void mp3_index_encode_header(const mp3_index_header_t* header, uint8_t* out);
+
+/**
+ * @brief Записать запись в MP3_INDEX_ENTRY_SIZE байт little-endian
+ */
+void mp3_index_encode_entry(const mp3_index_entry_t* entry, uint8_t* out);
+
+#ifdef __cplusplus
+}
+#endif
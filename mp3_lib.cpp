@@ -4,11 +4,24 @@
  *
  * Содержит:
  *  - Реализацию lifecycle API (создание детектора, сессий, анализ)
+ *  - Read-ahead кэш сессии: парсер получает proxy-ручки, мелкие соседние
+ *    чтения обслуживаются из окна в памяти
+ *  - Параллельные задачи парсера (parallel_for хоста): на их время кэш
+ *    обходится, а ввод-вывод считается атомарными счётчиками
+ *  - Асинхронный анализ (read_submit хоста): движок ведётся по шагам,
+ *    по одному чтению в полёте, кэш не используется
+ *  - Push-режим (mp3_stream_*): окна движка собираются из байт, которые
+ *    отдаёт хост; недочитанный хвост окна лежит в памяти кэша
+ *  - Отмену и срок анализа: перед каждым обращением к хосту проверяется
+ *    флаг mp3_session_cancel и deadline_us; прерванный анализ отдаёт
+ *    оценку движка по уже разобранному
  *  - Weak-символы mp3_rust_session_*_impl, которые Rust-библиотека
- *    перекрывает при линковке (если не линкуется — вернётся NOT_IMPLEMENTED)
+ *    перекрывает при линковке (если не линкуется — работает нативный
+ *    C++ движок из mp3_native.cpp)
  */
 
 #include "mp3_lib.h"
+#include "mp3_native.h"
 
 #ifndef MP3_LIB_NO_LOG
     #undef TAG
@@ -22,6 +35,7 @@
     #define logE(...)  ((void)0)
 #endif
 
+#include <atomic>
 #include <cstring>
 #include <new>
 
@@ -29,71 +43,1084 @@
 // Внутренние структуры
 // ============================================================================
 
+#ifndef MP3_READ_AHEAD_CAPACITY
+/// Ёмкость read-ahead кэша сессии (байт); окно хоста урезается до неё
+#define MP3_READ_AHEAD_CAPACITY 8192
+#endif
+
 struct mp3_detector_t {
-    uint8_t reserved;
+    uint8_t* pool;                  ///< Слоты сессий (NULL — пула нет)
+    size_t slot_size;
+    uint32_t capacity;
+    uint8_t heap_fallback;
+    uint8_t owns_memory;            ///< Детектор и пул — один блок из кучи
+    uint8_t owns_arena;             ///< Арена выделена детектором
+
+    // Bump-арена: [смещение:24 | живых сессий:8], сброс при последнем deinit
+    uint8_t* arena;
+    size_t arena_size;
+    std::atomic<uint32_t> arena_state{0};
+
+    // Аллокатор собственной памяти детектора (NULL — new/delete)
+    mp3_free_fn free;
+    void* alloc_ctx;
 };
 
 struct mp3_session_t {
     void* rust_session;
+    uint8_t storage;                ///< session_storage_t: откуда память сессии
+    mp3_detector_t* detector;       ///< Владелец слота пула / арены
+    mp3_free_fn free;               ///< Для SESSION_HOST: чем освободить
+    void* free_ctx;
+
+    mp3_host_api_t host;            ///< Ручки хоста как есть
+    mp3_host_api_t proxy;           ///< Ручки, отданные парсеру (через кэш)
+
+    // Read-ahead кэш: одно окно источника
+    uint64_t cache_offset;
+    size_t cache_len;
+    size_t read_ahead;              ///< Размер окна (0 — кэш выключен)
+    uint8_t cache_eof;              ///< Окно упёрлось в конец источника
+    mp3_read_ahead_stats_t stats;
+    mp3_session_stats_t run_stats;  ///< Ввод-вывод последнего run (без полей движка)
+    uint8_t cache[MP3_READ_AHEAD_CAPACITY];
+
+    // Идёт parallel_for: чтения из нескольких потоков, мимо кэша.
+    // Флаг пишется до и после parallel_for хоста, который сам синхронизирует потоки.
+    uint8_t parallel;
+    std::atomic<uint32_t> parallel_requests{0};
+    std::atomic<uint32_t> parallel_calls{0};
+    std::atomic<uint32_t> parallel_borrowed{0};
+    std::atomic<uint32_t> parallel_max_request{0};
+    std::atomic<uint64_t> parallel_requested{0};
+    std::atomic<uint64_t> parallel_returned{0};
+
+    // Асинхронный run: одно чтение read_submit в полёте
+    uint8_t async_state;            ///< async_state_t
+    mp3_result_t async_result;      ///< Чтение, завершённое прямо внутри read_submit
+    size_t async_len;
+    size_t async_requested;
+    uint64_t async_started;         ///< clock_us начала run (для total_us)
+
+    uint8_t stepping;               ///< Идёт анализ по шагам (mp3_session_begin)
+
+    // Push-режим: cache — байты потока [cache_offset, cache_offset + cache_len),
+    // ещё нужные движку; следующий байт потока — cache_offset + cache_len
+    uint8_t streaming;              ///< Идёт mp3_stream_begin .. mp3_stream_finish
+
+    // Прерывание: флаг пишет mp3_session_cancel из любого потока,
+    // срок задаётся запуском анализа
+    std::atomic<uint8_t> cancelled{0};
+    uint64_t deadline_us;           ///< По clock_us хоста; 0 — без срока
+};
+
+namespace {
+// Только константная инициализация и ни одной записи после неё —
+// поэтому общий детектор безопасен из любого потока без блокировок
+mp3_detector_t g_detector{};
+
+// ============================================================================
+// Proxy-ручки: парсер читает через read-ahead кэш сессии
+// ============================================================================
+
+/// Учесть одно обращение к хосту в статистике run
+void session_count_io(mp3_session_t* s, size_t requested, size_t returned) {
+    mp3_session_stats_t& st = s->run_stats;
+    st.read_calls++;
+    st.bytes_requested += requested;
+    st.bytes_returned += returned;
+    if (requested > st.max_request) {
+        st.max_request = static_cast<uint32_t>(requested);
+    }
+}
+
+/// session_count_io для чтений из задач parallel_for
+void session_count_parallel_io(mp3_session_t* s, size_t requested, size_t returned) {
+    s->parallel_calls.fetch_add(1, std::memory_order_relaxed);
+    s->parallel_requested.fetch_add(requested, std::memory_order_relaxed);
+    s->parallel_returned.fetch_add(returned, std::memory_order_relaxed);
+    uint32_t seen = s->parallel_max_request.load(std::memory_order_relaxed);
+    while (requested > seen &&
+           !s->parallel_max_request.compare_exchange_weak(
+               seen, static_cast<uint32_t>(requested), std::memory_order_relaxed)) {
+    }
+}
+
+/// Пора ли прервать анализ: MP3_ERR_CANCELLED / MP3_ERR_TIMEOUT; иначе MP3_OK
+mp3_result_t session_interrupt(const mp3_session_t* s) {
+    if (s->cancelled.load(std::memory_order_relaxed)) {
+        return MP3_ERR_CANCELLED;
+    }
+    if (s->deadline_us && s->host.clock_us(s->host.user_ctx) >= s->deadline_us) {
+        return MP3_ERR_TIMEOUT;
+    }
+    return MP3_OK;
+}
+
+bool is_interrupt(mp3_result_t result) {
+    return result == MP3_ERR_CANCELLED || result == MP3_ERR_TIMEOUT;
+}
+
+mp3_result_t session_host_read(
+    mp3_session_t* s,
+    uint64_t offset,
+    uint8_t* dst,
+    size_t requested,
+    size_t* out_read
+) {
+    *out_read = 0;
+    const mp3_result_t interrupt = session_interrupt(s);
+    if (interrupt != MP3_OK) {
+        return interrupt;
+    }
+
+    s->stats.host_calls++;
+    const mp3_result_t result =
+        s->host.read_at(s->host.user_ctx, offset, dst, requested, out_read);
+    if (*out_read > requested) {
+        *out_read = requested;
+    }
+    session_count_io(s, requested, *out_read);
+    return result;
+}
+
+/// Перечитать окно кэша с offset одним вызовом хоста
+mp3_result_t session_cache_fill(mp3_session_t* s, uint64_t offset) {
+    size_t window = s->read_ahead;
+    if (s->host.source_size) {
+        const uint64_t left = (offset < s->host.source_size)
+                                  ? s->host.source_size - offset
+                                  : 0;
+        if (window > left) {
+            window = static_cast<size_t>(left);
+        }
+    }
+
+    size_t got = 0;
+    const mp3_result_t result = window
+        ? session_host_read(s, offset, s->cache, window, &got)
+        : MP3_OK;
+    if (result != MP3_OK) {
+        s->cache_len = 0;
+        return result;
+    }
+
+    s->cache_offset = offset;
+    s->cache_len = got;
+    s->cache_eof = (got < s->read_ahead) ? 1 : 0;
+    return MP3_OK;
+}
+
+/**
+ * Попадание в окно копируется из кэша; остаток дочитывается одним вызовом
+ * хоста вместе с read-ahead, так что соседние мелкие чтения сливаются.
+ * Запросы не меньше окна идут в хост напрямую, минуя кэш.
+ */
+mp3_result_t session_read_at(
+    void* user_ctx,
+    uint64_t offset,
+    uint8_t* dst,
+    size_t requested,
+    size_t* out_read
+) {
+    auto* s = static_cast<mp3_session_t*>(user_ctx);
+    if (!s || !dst || !out_read) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    *out_read = 0;
+    if (s->parallel) {
+        // Одно окно кэша на несколько потоков не делится — читаем напрямую
+        const mp3_result_t interrupt = session_interrupt(s);
+        if (interrupt != MP3_OK) {
+            return interrupt;
+        }
+        s->parallel_requests.fetch_add(1, std::memory_order_relaxed);
+        const mp3_result_t result =
+            s->host.read_at(s->host.user_ctx, offset, dst, requested, out_read);
+        if (*out_read > requested) {
+            *out_read = requested;
+        }
+        session_count_parallel_io(s, requested, *out_read);
+        return result;
+    }
+
+    s->stats.requests++;
+
+    size_t done = 0;
+    const uint64_t cache_end = s->cache_offset + s->cache_len;
+    if (s->cache_len && offset >= s->cache_offset && offset < cache_end) {
+        const size_t hit = static_cast<size_t>(cache_end - offset);
+        done = (hit < requested) ? hit : requested;
+        std::memcpy(dst, s->cache + (offset - s->cache_offset), done);
+        s->stats.bytes_from_cache += done;
+    }
+
+    if (done == requested || (done && s->cache_eof)) {
+        s->stats.saved_calls++;
+        *out_read = done;
+        return MP3_OK;
+    }
+
+    const uint64_t tail_offset = offset + done;
+    const size_t tail = requested - done;
+
+    if (tail >= s->read_ahead) {
+        size_t got = 0;
+        const mp3_result_t result =
+            session_host_read(s, tail_offset, dst + done, tail, &got);
+        *out_read = done + got;
+        return result;
+    }
+
+    const mp3_result_t result = session_cache_fill(s, tail_offset);
+    if (result != MP3_OK) {
+        *out_read = done;
+        return result;
+    }
+
+    const size_t copy = (s->cache_len < tail) ? s->cache_len : tail;
+    std::memcpy(dst + done, s->cache, copy);
+    *out_read = done + copy;
+    return MP3_OK;
+}
+
+/**
+ * Borrow проксируется только к хосту с borrow_at: парсер разбирает данные
+ * прямо в памяти хоста, кэш сессии при этом не нужен.
+ */
+mp3_result_t session_borrow_at(
+    void* user_ctx,
+    uint64_t offset,
+    size_t requested,
+    const uint8_t** out_data,
+    size_t* out_len
+) {
+    auto* s = static_cast<mp3_session_t*>(user_ctx);
+    if (!s || !out_data || !out_len) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    const mp3_result_t interrupt = session_interrupt(s);
+    if (interrupt != MP3_OK) {
+        return interrupt;
+    }
+
+    if (s->parallel) {
+        const mp3_result_t result =
+            s->host.borrow_at(s->host.user_ctx, offset, requested, out_data, out_len);
+        if (result == MP3_OK) {
+            if (*out_len > requested) {
+                *out_len = requested;
+            }
+            s->parallel_requests.fetch_add(1, std::memory_order_relaxed);
+            s->parallel_borrowed.fetch_add(1, std::memory_order_relaxed);
+        }
+        session_count_parallel_io(s, requested, (result == MP3_OK) ? *out_len : 0);
+        return result;
+    }
+
+    s->stats.requests++;
+    s->stats.host_calls++;
+    const mp3_result_t result =
+        s->host.borrow_at(s->host.user_ctx, offset, requested, out_data, out_len);
+    if (result == MP3_OK) {
+        if (*out_len > requested) {
+            *out_len = requested;
+        }
+        s->stats.borrowed++;
+    } else if (result == MP3_ERR_NOT_IMPLEMENTED) {
+        // Не в счёт: парсер сейчас повторит запрос через read_at
+        s->stats.requests--;
+    }
+    session_count_io(s, requested, (result == MP3_OK) ? *out_len : 0);
+    return result;
+}
+
+void* session_alloc(void* user_ctx, size_t size) {
+    auto* s = static_cast<mp3_session_t*>(user_ctx);
+    return s->host.alloc(s->host.user_ctx, size);
+}
+
+void session_free(void* user_ctx, void* ptr) {
+    auto* s = static_cast<mp3_session_t*>(user_ctx);
+    s->host.free(s->host.user_ctx, ptr);
+}
+
+void session_log(void* user_ctx, int level, const char* msg) {
+    auto* s = static_cast<mp3_session_t*>(user_ctx);
+    s->host.log(s->host.user_ctx, level, msg);
+}
+
+uint64_t session_clock_us(void* user_ctx) {
+    auto* s = static_cast<mp3_session_t*>(user_ctx);
+    return s->host.clock_us(s->host.user_ctx);
+}
+
+/**
+ * Задачи парсера идут на потоки хоста; по возвращении их ввод-вывод
+ * добавляется к статистике кэша и run, как будто читал один поток.
+ */
+void session_parallel_for(void* parallel_ctx, uint32_t count, mp3_task_fn task, void* task_ctx) {
+    auto* s = static_cast<mp3_session_t*>(parallel_ctx);
+
+    s->parallel_requests.store(0, std::memory_order_relaxed);
+    s->parallel_calls.store(0, std::memory_order_relaxed);
+    s->parallel_borrowed.store(0, std::memory_order_relaxed);
+    s->parallel_max_request.store(0, std::memory_order_relaxed);
+    s->parallel_requested.store(0, std::memory_order_relaxed);
+    s->parallel_returned.store(0, std::memory_order_relaxed);
+
+    s->parallel = 1;
+    s->host.parallel_for(s->host.parallel_ctx, count, task, task_ctx);
+    s->parallel = 0;
+
+    const uint32_t calls = s->parallel_calls.load(std::memory_order_relaxed);
+    s->stats.requests += s->parallel_requests.load(std::memory_order_relaxed);
+    s->stats.host_calls += calls;
+    s->stats.borrowed += s->parallel_borrowed.load(std::memory_order_relaxed);
+
+    mp3_session_stats_t& st = s->run_stats;
+    st.read_calls += calls;
+    st.bytes_requested += s->parallel_requested.load(std::memory_order_relaxed);
+    st.bytes_returned += s->parallel_returned.load(std::memory_order_relaxed);
+    const uint32_t max_request = s->parallel_max_request.load(std::memory_order_relaxed);
+    if (max_request > st.max_request) {
+        st.max_request = max_request;
+    }
+}
+
+/// Запомнить ручки хоста, сбросить кэш и собрать proxy для парсера
+void session_attach(mp3_session_t* s, const mp3_host_api_t* host_api) {
+    s->host = *host_api;
+
+    if (host_api->read_ahead == MP3_READ_AHEAD_OFF) {
+        s->read_ahead = 0;
+    } else if (host_api->read_ahead == MP3_READ_AHEAD_DEFAULT ||
+               host_api->read_ahead > MP3_READ_AHEAD_CAPACITY) {
+        s->read_ahead = MP3_READ_AHEAD_CAPACITY;
+    } else {
+        s->read_ahead = host_api->read_ahead;
+    }
+
+    s->cache_offset = 0;
+    s->cache_len = 0;
+    s->cache_eof = 0;
+    std::memset(&s->stats, 0, sizeof(s->stats));
+    std::memset(&s->run_stats, 0, sizeof(s->run_stats));
+
+    s->proxy = *host_api;
+    s->proxy.user_ctx = s;
+    s->proxy.read_at = session_read_at;
+    s->proxy.borrow_at = host_api->borrow_at ? session_borrow_at : nullptr;
+    s->proxy.alloc = host_api->alloc ? session_alloc : nullptr;
+    s->proxy.free = host_api->free ? session_free : nullptr;
+    s->proxy.log = host_api->log ? session_log : nullptr;
+    s->proxy.clock_us = host_api->clock_us ? session_clock_us : nullptr;
+    s->proxy.parallel_for = host_api->parallel_for ? session_parallel_for : nullptr;
+    s->proxy.parallel_ctx = host_api->parallel_for ? s : nullptr;
+    s->proxy.read_submit = nullptr;     // асинхронные чтения ведёт прокладка
+}
+
+} // namespace
+
+// ============================================================================
+// Weak-символы — проксируют в Rust blob
+// Если Rust .a не слинкован — используется нативный движок mp3_native
+// ============================================================================
+
+extern "C" {
+
+#ifdef __GNUC__
+#define MP3_WEAK __attribute__((weak))
+#else
+#define MP3_WEAK
+#endif
+
+static_assert(alignof(mp3_native::session_t) <= MP3_SESSION_STORAGE_ALIGN,
+              "native session must fit MP3_SESSION_STORAGE_ALIGN");
+
+MP3_WEAK size_t mp3_rust_session_storage_size_impl(void) {
+    return sizeof(mp3_native::session_t);
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_init_impl(
+    void* storage,
+    const mp3_host_api_t* host_api,
+    void** out_rust_session
+) {
+    if (!storage || !host_api || !out_rust_session) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    auto* native = new (storage) mp3_native::session_t;
+    native->host = *host_api;
+    native->analyzer.reset(host_api->source_size);
+    std::memset(native->phase_us, 0, sizeof(native->phase_us));
+    native->progress = nullptr;
+    *out_rust_session = native;
+    return MP3_OK;
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_run_impl(
+    void* rust_session,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+) {
+    if (!rust_session || !options || !out_info) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    return mp3_native::session_run(
+        static_cast<mp3_native::session_t*>(rust_session), options, out_info);
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_reset_impl(
+    void* rust_session,
+    const mp3_host_api_t* host_api
+) {
+    if (!rust_session || !host_api) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    auto* native = static_cast<mp3_native::session_t*>(rust_session);
+    native->host = *host_api;
+    native->analyzer.reset(host_api->source_size);
+    std::memset(native->phase_us, 0, sizeof(native->phase_us));
+    return MP3_OK;
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_get_stats_impl(
+    void* rust_session,
+    mp3_session_stats_t* out_stats
+) {
+    if (!rust_session || !out_stats) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_native::session_stats(
+        static_cast<const mp3_native::session_t*>(rust_session), out_stats);
+    return MP3_OK;
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_get_estimate_impl(
+    void* rust_session,
+    mp3_duration_estimate_t* out_estimate
+) {
+    if (!rust_session || !out_estimate) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    return mp3_native::session_estimate(
+        static_cast<const mp3_native::session_t*>(rust_session), out_estimate);
+}
+
+// Анализ по шагам: mp3_session_step (чтения — через proxy-ручки) и
+// mp3_session_run_async (чтения делает прокладка)
+
+/// *out_done = 1 — анализ закончен, итог — mp3_rust_session_finish_impl
+MP3_WEAK mp3_result_t mp3_rust_session_step_impl(
+    void* rust_session,
+    uint32_t budget_bytes,
+    uint8_t* out_done
+) {
+    if (!rust_session || !out_done) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    *out_done = mp3_native::session_step(
+        static_cast<mp3_native::session_t*>(rust_session), budget_bytes) ? 1 : 0;
+    return MP3_OK;
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_begin_impl(
+    void* rust_session,
+    const mp3_analyze_options_t* options
+) {
+    if (!rust_session || !options) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_native::session_begin(static_cast<mp3_native::session_t*>(rust_session), options);
+    return MP3_OK;
+}
+
+/// MP3_ERR_PENDING — прочитать size байт с offset в dst; MP3_OK — анализ закончен
+MP3_WEAK mp3_result_t mp3_rust_session_pending_impl(
+    void* rust_session,
+    uint64_t* out_offset,
+    uint8_t** out_dst,
+    size_t* out_size
+) {
+    if (!rust_session || !out_offset || !out_dst || !out_size) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    auto* native = static_cast<mp3_native::session_t*>(rust_session);
+    mp3_native::request_t req;
+    if (!mp3_native::session_pending(native, &req)) {
+        return MP3_OK;
+    }
+    *out_offset = req.offset;
+    *out_dst = native->scratch;
+    *out_size = req.size;
+    return MP3_ERR_PENDING;
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_feed_impl(
+    void* rust_session,
+    mp3_result_t read_result,
+    size_t read_len
+) {
+    if (!rust_session) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_native::session_feed(
+        static_cast<mp3_native::session_t*>(rust_session), read_result, read_len);
+    return MP3_OK;
+}
+
+MP3_WEAK mp3_result_t mp3_rust_session_finish_impl(
+    void* rust_session,
+    mp3_audio_info_t* out_info
+) {
+    if (!rust_session || !out_info) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    return mp3_native::session_finish(
+        static_cast<mp3_native::session_t*>(rust_session), out_info);
+}
+
+/// Промежуточный результат; MP3_ERR_PENDING — длительности ещё нет
+MP3_WEAK mp3_result_t mp3_rust_session_progress_impl(
+    void* rust_session,
+    mp3_audio_info_t* out_info
+) {
+    if (!rust_session || !out_info) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    return mp3_native::session_progress(
+        static_cast<const mp3_native::session_t*>(rust_session), out_info);
+}
+
+MP3_WEAK void mp3_rust_session_deinit_impl(void* rust_session) {
+    if (rust_session) {
+        static_cast<mp3_native::session_t*>(rust_session)->~session_t();
+    }
+}
+
+} // extern "C"
+
+// ============================================================================
+// Память сессий: пул или арена детектора, аллокатор хоста, куча,
+// буфер вызывающего
+//
+// Сессия — один блок: [mp3_session_t][состояние движка].
+// Слот пула — [флаг занятости][сессия].
+// ============================================================================
+
+namespace {
+
+enum session_storage_t : uint8_t {
+    SESSION_HEAP,       ///< new[] — у хоста нет alloc/free
+    SESSION_HOST,       ///< mp3_host_api_t::alloc
+    SESSION_INPLACE,
+    SESSION_POOL,
+    SESSION_ARENA,
 };
 
-namespace {
-mp3_detector_t g_detector{};
+constexpr size_t align_up(size_t size) {
+    return (size + MP3_SESSION_STORAGE_ALIGN - 1) & ~size_t(MP3_SESSION_STORAGE_ALIGN - 1);
+}
+
+constexpr size_t SESSION_ENGINE_OFFSET = align_up(sizeof(mp3_session_t));
+constexpr size_t SLOT_HEADER_SIZE = align_up(sizeof(std::atomic<uint8_t>));
+constexpr size_t DETECTOR_HEADER_SIZE = align_up(sizeof(mp3_detector_t));
+
+constexpr uint32_t ARENA_OFFSET_BITS = 24;
+constexpr uint32_t ARENA_OFFSET_MASK = (1u << ARENA_OFFSET_BITS) - 1;
+constexpr uint32_t ARENA_MAX_LIVE = 0xFF;
+
+static_assert(alignof(mp3_session_t) <= MP3_SESSION_STORAGE_ALIGN &&
+              alignof(mp3_detector_t) <= MP3_SESSION_STORAGE_ALIGN,
+              "bridge structures must fit MP3_SESSION_STORAGE_ALIGN");
+
+size_t slot_size() {
+    return SLOT_HEADER_SIZE + align_up(mp3_session_storage_size());
+}
+
+bool is_aligned(const void* p) {
+    return (reinterpret_cast<uintptr_t>(p) & (MP3_SESSION_STORAGE_ALIGN - 1)) == 0;
+}
+
+std::atomic<uint8_t>* slot_busy(const mp3_detector_t* detector, uint32_t index) {
+    return reinterpret_cast<std::atomic<uint8_t>*>(detector->pool + index * detector->slot_size);
+}
+
+/// Занять свободный слот пула; NULL — все заняты
+void* pool_acquire(mp3_detector_t* detector) {
+    for (uint32_t i = 0; i < detector->capacity; ++i) {
+        std::atomic<uint8_t>* busy = slot_busy(detector, i);
+        uint8_t expected = 0;
+        if (busy->load(std::memory_order_relaxed) == 0 &&
+            busy->compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+            return reinterpret_cast<uint8_t*>(busy) + SLOT_HEADER_SIZE;
+        }
+    }
+    return nullptr;
+}
+
+void pool_release(void* storage) {
+    auto* busy = reinterpret_cast<std::atomic<uint8_t>*>(
+        static_cast<uint8_t*>(storage) - SLOT_HEADER_SIZE);
+    busy->store(0, std::memory_order_release);
+}
+
+/**
+ * Сдвинуть вершину арены. Смещение и число живых сессий лежат в одном
+ * атомарном слове, поэтому сброс при последнем deinit не гоняется
+ * с параллельной аллокацией.
+ */
+void* arena_alloc(mp3_detector_t* detector, size_t size) {
+    if (!detector->arena) {
+        return nullptr;
+    }
+
+    uint32_t state = detector->arena_state.load(std::memory_order_relaxed);
+    for (;;) {
+        const uint32_t live = state >> ARENA_OFFSET_BITS;
+        const size_t start = align_up(state & ARENA_OFFSET_MASK);
+        if (live == ARENA_MAX_LIVE || size > detector->arena_size ||
+            start > detector->arena_size - size) {
+            return nullptr;
+        }
+
+        const uint32_t next = static_cast<uint32_t>(start + size) |
+                              ((live + 1) << ARENA_OFFSET_BITS);
+        if (detector->arena_state.compare_exchange_weak(
+                state, next, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return detector->arena + start;
+        }
+    }
+}
+
+void arena_release(mp3_detector_t* detector) {
+    uint32_t state = detector->arena_state.load(std::memory_order_relaxed);
+    for (;;) {
+        const uint32_t live = (state >> ARENA_OFFSET_BITS) - 1;
+        const uint32_t next = live ? ((state & ARENA_OFFSET_MASK) | (live << ARENA_OFFSET_BITS))
+                                   : 0;
+        if (detector->arena_state.compare_exchange_weak(
+                state, next, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+/// Память детектора: аллокатор из конфигурации или new[]
+void* detector_alloc(const mp3_detector_config_t* config, size_t size) {
+    if (config && config->alloc && config->free) {
+        void* memory = config->alloc(config->alloc_ctx, size);
+        if (memory && !is_aligned(memory)) {
+            config->free(config->alloc_ctx, memory);
+            return nullptr;
+        }
+        return memory;
+    }
+    return new (std::nothrow) uint8_t[size];
+}
+
+void detector_free(const mp3_detector_t* detector, void* memory) {
+    if (detector->free) {
+        detector->free(detector->alloc_ctx, memory);
+    } else {
+        delete[] static_cast<uint8_t*>(memory);
+    }
+}
+
+/// Разложить детектор и слоты пула в блоке memory
+mp3_detector_t* detector_place(
+    void* memory,
+    uint32_t capacity,
+    const mp3_detector_config_t* config,
+    uint8_t owns_memory
+) {
+    auto* detector = new (memory) mp3_detector_t{};
+    detector->pool = capacity ? static_cast<uint8_t*>(memory) + DETECTOR_HEADER_SIZE : nullptr;
+    detector->slot_size = slot_size();
+    detector->capacity = capacity;
+    detector->heap_fallback = config ? config->heap_fallback : 0;
+    detector->owns_memory = owns_memory;
+    if (config && config->alloc && config->free) {
+        detector->free = config->free;
+        detector->alloc_ctx = config->alloc_ctx;
+    }
+
+    for (uint32_t i = 0; i < capacity; ++i) {
+        new (slot_busy(detector, i)) std::atomic<uint8_t>(0);
+    }
+    return detector;
+}
+
+/// Подключить арену из конфигурации; false — не хватило памяти
+bool detector_attach_arena(mp3_detector_t* detector, const mp3_detector_config_t* config) {
+    if (!config || config->arena_size == 0) {
+        return true;
+    }
+
+    size_t size = config->arena_size;
+    if (size > ARENA_OFFSET_MASK) {
+        size = ARENA_OFFSET_MASK;
+    }
+
+    if (config->arena) {
+        if (!is_aligned(config->arena)) {
+            return false;
+        }
+        detector->arena = static_cast<uint8_t*>(config->arena);
+    } else {
+        detector->arena = static_cast<uint8_t*>(detector_alloc(config, size));
+        if (!detector->arena) {
+            return false;
+        }
+        detector->owns_arena = 1;
+    }
+    detector->arena_size = size;
+    return true;
+}
+
+/// Собрать сессию и движок в готовом блоке storage
+mp3_result_t session_construct(
+    void* storage,
+    uint8_t kind,
+    mp3_detector_t* detector,
+    const mp3_host_api_t* host_api,
+    mp3_session_t** out_session
+) {
+    auto* session = new (storage) mp3_session_t{};
+    session->storage = kind;
+    session->detector = detector;
+    if (kind == SESSION_HOST) {
+        session->free = host_api->free;
+        session->free_ctx = host_api->user_ctx;
+    }
+    session_attach(session, host_api);
+
+    void* rust_session = nullptr;
+    const mp3_result_t init_result = mp3_rust_session_init_impl(
+        static_cast<uint8_t*>(storage) + SESSION_ENGINE_OFFSET, &session->proxy, &rust_session);
+    if (init_result != MP3_OK) {
+        return init_result;
+    }
+
+    session->rust_session = rust_session;
+    *out_session = session;
+    return MP3_OK;
+}
+
+/// Вернуть память сессии туда, откуда она взята
+void session_release(mp3_session_t* session) {
+    switch (session->storage) {
+        case SESSION_HEAP:
+            delete[] reinterpret_cast<uint8_t*>(session);
+            break;
+        case SESSION_HOST:
+            session->free(session->free_ctx, session);
+            break;
+        case SESSION_POOL:
+            pool_release(session);
+            break;
+        case SESSION_ARENA:
+            arena_release(session->detector);
+            break;
+        default:
+            break;
+    }
+}
+
+/// Память под новую сессию: пул, арена, затем аллокатор хоста или куча
+void* session_alloc_storage(
+    mp3_detector_t* detector,
+    const mp3_host_api_t* host_api,
+    uint8_t* out_kind
+) {
+    const size_t size = mp3_session_storage_size();
+
+    void* storage = pool_acquire(detector);
+    if (storage) {
+        *out_kind = SESSION_POOL;
+        return storage;
+    }
+
+    storage = arena_alloc(detector, size);
+    if (storage) {
+        *out_kind = SESSION_ARENA;
+        return storage;
+    }
+
+    if ((detector->capacity || detector->arena) && !detector->heap_fallback) {
+        return nullptr;
+    }
+
+    if (host_api->alloc && host_api->free) {
+        storage = host_api->alloc(host_api->user_ctx, size);
+        if (storage && !is_aligned(storage)) {
+            host_api->free(host_api->user_ctx, storage);
+            return nullptr;
+        }
+        *out_kind = SESSION_HOST;
+        return storage;
+    }
+
+    *out_kind = SESSION_HEAP;
+    return new (std::nothrow) uint8_t[size];
 }
 
 // ============================================================================
-// Weak-символы — проксируют в Rust blob
-// Если Rust .a не слинкован — используются эти заглушки
+// Асинхронный анализ: движок по шагам, чтения — через read_submit хоста
 // ============================================================================
 
-extern "C" {
-
-#ifdef __GNUC__
-#define MP3_WEAK __attribute__((weak))
-#else
-#define MP3_WEAK
-#endif
+enum async_state_t : uint8_t {
+    ASYNC_IDLE,
+    ASYNC_SUBMITTING,       ///< Внутри read_submit
+    ASYNC_INLINE,           ///< Хост завершил чтение, не выходя из read_submit
+    ASYNC_WAITING,          ///< Чтение в полёте, ждём mp3_session_complete
+};
 
-MP3_WEAK mp3_result_t mp3_rust_session_init_impl(
-    const mp3_host_api_t* host_api,
-    void** out_rust_session
-) {
-    (void)host_api;
-    (void)out_rust_session;
-    return MP3_ERR_NOT_IMPLEMENTED;
+/**
+ * Новый анализ: срок из options. Отмену запуск не снимает — иначе
+ * cancel(), пришедший между решением хоста запустить анализ и самим
+ * запуском, потерялся бы; её снимает только mp3_session_reset.
+ */
+void session_arm(mp3_session_t* s, const mp3_analyze_options_t* options) {
+    s->deadline_us = options->deadline_us;
 }
 
-MP3_WEAK mp3_result_t mp3_rust_session_run_impl(
-    void* rust_session,
-    mp3_audio_info_t* out_info
-) {
-    (void)rust_session;
-    if (out_info) {
+/// Прерванный анализ (is_interrupt): в out_info — оценка движка по разобранному
+void session_interrupted_info(mp3_session_t* s, mp3_result_t result, mp3_audio_info_t* out_info) {
+    if (!is_interrupt(result)) {
+        return;
+    }
+    if (mp3_rust_session_progress_impl(s->rust_session, out_info) != result) {
         std::memset(out_info, 0, sizeof(*out_info));
     }
-    return MP3_ERR_NOT_IMPLEMENTED;
 }
 
-MP3_WEAK void mp3_rust_session_deinit_impl(void* rust_session) {
-    (void)rust_session;
+/// Отдать движку результат чтения и учесть его в статистике
+void session_async_feed(mp3_session_t* s, mp3_result_t read_result, size_t read_len) {
+    if (read_len > s->async_requested) {
+        read_len = s->async_requested;
+    }
+    s->stats.requests++;
+    s->stats.host_calls++;
+    session_count_io(s, s->async_requested, (read_result == MP3_OK) ? read_len : 0);
+    mp3_rust_session_feed_impl(s->rust_session, read_result, read_len);
+}
+
+/**
+ * Отправлять чтения движка, пока хост завершает их сразу (внутри
+ * read_submit) — без рекурсии через mp3_session_complete.
+ * MP3_ERR_PENDING — чтение в полёте; иначе итог анализа.
+ */
+mp3_result_t session_async_pump(mp3_session_t* s, mp3_audio_info_t* out_info) {
+    for (;;) {
+        uint64_t offset = 0;
+        uint8_t* dst = nullptr;
+        size_t size = 0;
+        if (mp3_rust_session_pending_impl(s->rust_session, &offset, &dst, &size) !=
+            MP3_ERR_PENDING) {
+            break;
+        }
+
+        const mp3_result_t interrupt = session_interrupt(s);
+        if (interrupt != MP3_OK) {
+            mp3_rust_session_feed_impl(s->rust_session, interrupt, 0);
+            continue;
+        }
+
+        s->async_state = ASYNC_SUBMITTING;
+        s->async_requested = size;
+        const mp3_result_t submitted =
+            s->host.read_submit(s->host.user_ctx, offset, dst, size, s);
+        if (submitted != MP3_OK) {
+            s->async_state = ASYNC_IDLE;
+            session_async_feed(s, submitted, 0);
+            continue;
+        }
+        if (s->async_state == ASYNC_SUBMITTING) {
+            s->async_state = ASYNC_WAITING;
+            return MP3_ERR_PENDING;
+        }
+
+        s->async_state = ASYNC_IDLE;
+        session_async_feed(s, s->async_result, s->async_len);
+    }
+
+    s->async_state = ASYNC_IDLE;
+    const mp3_host_api_t& host = s->host;
+    if (host.clock_us) {
+        s->run_stats.total_us = host.clock_us(host.user_ctx) - s->async_started;
+    }
+    std::memset(out_info, 0, sizeof(*out_info));
+    const mp3_result_t result = mp3_rust_session_finish_impl(s->rust_session, out_info);
+    session_interrupted_info(s, result, out_info);
+    return result;
+}
+
+// ============================================================================
+// Push-режим: хост сам отдаёт байты потока по порядку
+// ============================================================================
+
+/// Выйти из push-режима: в cache лежат байты потока, а не окно источника
+void session_stream_stop(mp3_session_t* s) {
+    if (s->streaming) {
+        s->streaming = 0;
+        s->cache_offset = 0;
+        s->cache_len = 0;
+        s->cache_eof = 0;
+    }
+}
+
+/**
+ * Отдать движку все окна, которые собираются из хвоста в cache и data
+ * (data — байты потока сразу за хвостом). Несобранный остаток окна
+ * переносится в cache; байты, которые движку не нужны (пропуск тегов,
+ * после конца анализа), отбрасываются. eof — потока больше не будет:
+ * неполное окно отдаётся как конец источника.
+ */
+void session_stream_pump(mp3_session_t* s, const uint8_t* data, size_t len, bool eof) {
+    const uint64_t data_offset = s->cache_offset + s->cache_len;
+    const uint64_t end = data_offset + len;
+
+    for (;;) {
+        uint64_t offset = 0;
+        uint8_t* dst = nullptr;
+        size_t size = 0;
+        if (mp3_rust_session_pending_impl(s->rust_session, &offset, &dst, &size) !=
+            MP3_ERR_PENDING) {
+            s->cache_offset = end;
+            s->cache_len = 0;
+            return;
+        }
+
+        const mp3_result_t interrupt = session_interrupt(s);
+        if (interrupt != MP3_OK) {
+            mp3_rust_session_feed_impl(s->rust_session, interrupt, 0);
+            continue;
+        }
+        if (offset < s->cache_offset) {
+            // Поток назад не перематывается
+            mp3_rust_session_feed_impl(s->rust_session, MP3_ERR_IO, 0);
+            continue;
+        }
+        if (offset >= end && !eof) {
+            s->cache_offset = end;
+            s->cache_len = 0;
+            return;
+        }
+
+        const size_t have = (offset < end) ? static_cast<size_t>(end - offset) : 0;
+        if (have < size && !eof) {
+            // Окно не собрано: хвост потока с offset — в cache до следующего вызова
+            if (have > sizeof(s->cache)) {
+                mp3_rust_session_feed_impl(s->rust_session, MP3_ERR_INTERNAL, 0);
+                continue;
+            }
+            size_t kept = 0;
+            if (offset < data_offset) {
+                kept = static_cast<size_t>(data_offset - offset);
+                std::memmove(s->cache, s->cache + (offset - s->cache_offset), kept);
+            }
+            std::memcpy(s->cache + kept, data + (len - (have - kept)), have - kept);
+            s->cache_offset = offset;
+            s->cache_len = have;
+            return;
+        }
+
+        // Окно целиком (или остаток потока при eof): часть из cache, часть из data
+        const size_t n = have < size ? have : size;
+        size_t copied = 0;
+        if (offset < data_offset) {
+            copied = static_cast<size_t>(data_offset - offset);
+            if (copied > n) {
+                copied = n;
+            }
+            std::memcpy(dst, s->cache + (offset - s->cache_offset), copied);
+        }
+        if (n > copied) {
+            std::memcpy(dst + copied, data + (offset + copied - data_offset), n - copied);
+        }
+        s->stats.requests++;
+        mp3_rust_session_feed_impl(s->rust_session, MP3_OK, n);
+    }
 }
 
+} // namespace
+
+extern "C" {
+
 // ============================================================================
 // Lifecycle API
 // ============================================================================
 
 mp3_detector_t* mp3_detector_create(void) {
-    return &g_detector;
+    return mp3_detector_create_ex(nullptr);
+}
+
+mp3_detector_t* mp3_detector_create_ex(const mp3_detector_config_t* config) {
+    mp3_detector_t* detector;
+
+    if (config && config->session_pool) {
+        if (!is_aligned(config->session_pool) ||
+            config->session_pool_size < DETECTOR_HEADER_SIZE) {
+            return nullptr;
+        }
+        const size_t slots = (config->session_pool_size - DETECTOR_HEADER_SIZE) / slot_size();
+        const uint32_t capacity = (slots > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(slots);
+        detector = detector_place(config->session_pool, capacity, config, 0);
+    } else {
+        const uint32_t capacity = config ? config->session_pool_capacity : 0;
+        void* memory = detector_alloc(config, mp3_detector_storage_size(capacity));
+        if (!memory) {
+            return nullptr;
+        }
+        detector = detector_place(memory, capacity, config, 1);
+    }
+
+    if (!detector_attach_arena(detector, config)) {
+        mp3_detector_destroy(detector);
+        return nullptr;
+    }
+    return detector;
 }
 
 void mp3_detector_destroy(mp3_detector_t* detector) {
-    (void)detector;
+    if (!detector || detector == &g_detector) {
+        return;
+    }
+    if (detector->owns_arena) {
+        detector_free(detector, detector->arena);
+    }
+    if (detector->owns_memory) {
+        detector_free(detector, detector);
+    }
 }
 
 mp3_detector_t* mp3_detector_instance(void) {
     return &g_detector;
 }
 
+size_t mp3_detector_storage_size(uint32_t capacity) {
+    return DETECTOR_HEADER_SIZE + static_cast<size_t>(capacity) * slot_size();
+}
+
+size_t mp3_session_storage_size(void) {
+    return SESSION_ENGINE_OFFSET + mp3_rust_session_storage_size_impl();
+}
+
 mp3_result_t mp3_session_init(
     mp3_detector_t* detector,
     const mp3_host_api_t* host_api,
@@ -103,37 +1130,384 @@ mp3_result_t mp3_session_init(
         return MP3_ERR_INVALID_PTR;
     }
 
-    if (!host_api->read_at) {
-        return MP3_ERR_INVALID_ARG;
-    }
-
     *out_session = nullptr;
 
-    auto* session = new (std::nothrow) mp3_session_t{};
-    if (!session) {
+    uint8_t kind = SESSION_HEAP;
+    void* storage = session_alloc_storage(detector, host_api, &kind);
+    if (!storage) {
         return MP3_ERR_OUT_OF_MEMORY;
     }
 
-    void* rust_session = nullptr;
     const mp3_result_t init_result =
-        mp3_rust_session_init_impl(host_api, &rust_session);
+        session_construct(storage, kind, detector, host_api, out_session);
     if (init_result != MP3_OK) {
-        delete session;
-        return init_result;
+        session_release(static_cast<mp3_session_t*>(storage));
+    }
+    return init_result;
+}
+
+mp3_result_t mp3_session_init_inplace(
+    mp3_detector_t* detector,
+    const mp3_host_api_t* host_api,
+    void* storage,
+    size_t storage_size,
+    mp3_session_t** out_session
+) {
+    if (!detector || !host_api || !storage || !out_session) {
+        return MP3_ERR_INVALID_PTR;
     }
 
-    session->rust_session = rust_session;
-    *out_session = session;
-    return MP3_OK;
+    if (!is_aligned(storage) || storage_size < mp3_session_storage_size()) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    *out_session = nullptr;
+    return session_construct(storage, SESSION_INPLACE, detector, host_api, out_session);
 }
 
 mp3_result_t mp3_session_run(mp3_session_t* session, mp3_audio_info_t* out_info) {
+    return mp3_session_run_ex(session, nullptr, out_info);
+}
+
+mp3_result_t mp3_session_run_ex(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+) {
+    if (!session || !out_info) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_analyze_options_t defaults{};
+    defaults.mode = MP3_MODE_TRUST_XING;
+    if (!options) {
+        options = &defaults;
+    }
+    if (options->mode > MP3_MODE_EXACT_SCAN || !session->host.read_at ||
+        (options->deadline_us && !session->host.clock_us) ||
+        session->async_state != ASYNC_IDLE) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    session->stepping = 0;
+    session_stream_stop(session);
+    session_arm(session, options);
+    std::memset(out_info, 0, sizeof(*out_info));
+    std::memset(&session->run_stats, 0, sizeof(session->run_stats));
+
+    const mp3_host_api_t& host = session->host;
+    const uint64_t started = host.clock_us ? host.clock_us(host.user_ctx) : 0;
+    const mp3_result_t result =
+        mp3_rust_session_run_impl(session->rust_session, options, out_info);
+    if (host.clock_us) {
+        session->run_stats.total_us = host.clock_us(host.user_ctx) - started;
+    }
+    session_interrupted_info(session, result, out_info);
+    return result;
+}
+
+mp3_result_t mp3_session_begin(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options
+) {
+    if (!session) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_analyze_options_t defaults{};
+    defaults.mode = MP3_MODE_TRUST_XING;
+    if (!options) {
+        options = &defaults;
+    }
+    if (options->mode > MP3_MODE_EXACT_SCAN || !session->host.read_at ||
+        (options->deadline_us && !session->host.clock_us) ||
+        session->async_state != ASYNC_IDLE) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    session->stepping = 0;
+    session_stream_stop(session);
+    session_arm(session, options);
+    std::memset(&session->run_stats, 0, sizeof(session->run_stats));
+    const mp3_result_t result = mp3_rust_session_begin_impl(session->rust_session, options);
+    if (result == MP3_OK) {
+        session->stepping = 1;
+    }
+    return result;
+}
+
+mp3_result_t mp3_session_step(
+    mp3_session_t* session,
+    uint32_t budget_bytes,
+    uint8_t* out_done,
+    mp3_audio_info_t* out_info
+) {
+    if (!session || !out_done || !out_info) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    *out_done = 0;
+    if (!session->stepping) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    const mp3_host_api_t& host = session->host;
+    const uint64_t started = host.clock_us ? host.clock_us(host.user_ctx) : 0;
+    uint8_t done = 0;
+    const mp3_result_t result =
+        mp3_rust_session_step_impl(session->rust_session, budget_bytes, &done);
+
+    mp3_session_stats_t& st = session->run_stats;
+    st.steps++;
+    if (host.clock_us) {
+        const uint64_t us = host.clock_us(host.user_ctx) - started;
+        st.total_us += us;
+        if (us > st.max_step_us) {
+            st.max_step_us = us;
+        }
+    }
+
+    if (result != MP3_OK) {
+        session->stepping = 0;
+        *out_done = 1;
+        std::memset(out_info, 0, sizeof(*out_info));
+        return result;
+    }
+    if (!done) {
+        return MP3_OK;
+    }
+
+    session->stepping = 0;
+    *out_done = 1;
+    std::memset(out_info, 0, sizeof(*out_info));
+    const mp3_result_t finished = mp3_rust_session_finish_impl(session->rust_session, out_info);
+    session_interrupted_info(session, finished, out_info);
+    return finished;
+}
+
+mp3_result_t mp3_session_run_async(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+) {
+    if (!session || !out_info) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_analyze_options_t defaults{};
+    defaults.mode = MP3_MODE_TRUST_XING;
+    if (!options) {
+        options = &defaults;
+    }
+    if (options->mode > MP3_MODE_EXACT_SCAN ||
+        (options->deadline_us && !session->host.clock_us) ||
+        session->async_state != ASYNC_IDLE) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    session->stepping = 0;
+    session_stream_stop(session);
+    session_arm(session, options);
+    if (session->host.read_submit) {
+        const mp3_result_t begun = mp3_rust_session_begin_impl(session->rust_session, options);
+        if (begun == MP3_OK) {
+            std::memset(&session->run_stats, 0, sizeof(session->run_stats));
+            const mp3_host_api_t& host = session->host;
+            session->async_started = host.clock_us ? host.clock_us(host.user_ctx) : 0;
+            return session_async_pump(session, out_info);
+        }
+        if (begun != MP3_ERR_NOT_IMPLEMENTED) {
+            return begun;
+        }
+    }
+
+    // Движок не умеет по шагам или у хоста только read_at — блокирующий run
+    return mp3_session_run_ex(session, options, out_info);
+}
+
+mp3_result_t mp3_session_complete(
+    mp3_session_t* session,
+    mp3_result_t read_result,
+    size_t read_len,
+    mp3_audio_info_t* out_info
+) {
+    if (!session || !out_info) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    switch (session->async_state) {
+        case ASYNC_SUBMITTING:
+            // Внутри read_submit: данные заберёт session_async_pump
+            session->async_result = read_result;
+            session->async_len = read_len;
+            session->async_state = ASYNC_INLINE;
+            return MP3_ERR_PENDING;
+        case ASYNC_WAITING:
+            session->async_state = ASYNC_IDLE;
+            session_async_feed(session, read_result, read_len);
+            return session_async_pump(session, out_info);
+        default:
+            return MP3_ERR_INVALID_ARG;
+    }
+}
+
+mp3_result_t mp3_stream_begin(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options
+) {
+    if (!session) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_analyze_options_t defaults{};
+    defaults.mode = MP3_MODE_TRUST_XING;
+    if (!options) {
+        options = &defaults;
+    }
+    if (options->mode > MP3_MODE_EXACT_SCAN || session->host.source_size ||
+        (options->deadline_us && !session->host.clock_us) ||
+        session->async_state != ASYNC_IDLE) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    session->stepping = 0;
+    session_stream_stop(session);
+    session_arm(session, options);
+    std::memset(&session->run_stats, 0, sizeof(session->run_stats));
+    const mp3_result_t result = mp3_rust_session_begin_impl(session->rust_session, options);
+    if (result == MP3_OK) {
+        // Окно read-ahead больше не описывает источник: теперь в cache хвост потока
+        session->streaming = 1;
+        session->cache_offset = 0;
+        session->cache_len = 0;
+        session->cache_eof = 0;
+    }
+    return result;
+}
+
+mp3_result_t mp3_stream_feed(
+    mp3_session_t* session,
+    const uint8_t* data,
+    size_t len,
+    mp3_audio_info_t* out_info
+) {
+    if (!session || (!data && len)) {
+        return MP3_ERR_INVALID_PTR;
+    }
+    if (!session->streaming) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    const mp3_host_api_t& host = session->host;
+    const uint64_t started = host.clock_us ? host.clock_us(host.user_ctx) : 0;
+    session_count_io(session, len, len);
+    session_stream_pump(session, data, len, false);
+    if (host.clock_us) {
+        session->run_stats.total_us += host.clock_us(host.user_ctx) - started;
+    }
+
+    mp3_audio_info_t running;
+    const mp3_result_t result =
+        mp3_rust_session_progress_impl(session->rust_session, &running);
+    if (result != MP3_OK && !is_interrupt(result)) {
+        std::memset(&running, 0, sizeof(running));
+    }
+    if (out_info) {
+        *out_info = running;
+    }
+    if (result == MP3_ERR_PENDING || result == MP3_ERR_NOT_IMPLEMENTED) {
+        return MP3_OK;
+    }
+    return result;
+}
+
+mp3_result_t mp3_stream_finish(mp3_session_t* session, mp3_audio_info_t* out_info) {
     if (!session || !out_info) {
         return MP3_ERR_INVALID_PTR;
     }
+    if (!session->streaming) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    const mp3_host_api_t& host = session->host;
+    const uint64_t started = host.clock_us ? host.clock_us(host.user_ctx) : 0;
+    session_stream_pump(session, nullptr, 0, true);
+    session_stream_stop(session);
+    if (host.clock_us) {
+        session->run_stats.total_us += host.clock_us(host.user_ctx) - started;
+    }
 
     std::memset(out_info, 0, sizeof(*out_info));
-    return mp3_rust_session_run_impl(session->rust_session, out_info);
+    const mp3_result_t result = mp3_rust_session_finish_impl(session->rust_session, out_info);
+    session_interrupted_info(session, result, out_info);
+    return result;
+}
+
+mp3_result_t mp3_session_reset(mp3_session_t* session, const mp3_host_api_t* host_api) {
+    if (!session || !host_api) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    if (session->async_state != ASYNC_IDLE) {
+        return MP3_ERR_INVALID_ARG;
+    }
+
+    session->stepping = 0;
+    session->streaming = 0;
+    // seq_cst в паре с mp3_session_cancel: хост, который после reset
+    // проверяет свой флаг отмены, видит и отмену, стёртую здесь
+    session->deadline_us = 0;
+    session->cancelled.store(0);
+    session_attach(session, host_api);
+    return mp3_rust_session_reset_impl(session->rust_session, &session->proxy);
+}
+
+mp3_result_t mp3_session_get_read_ahead_stats(
+    const mp3_session_t* session,
+    mp3_read_ahead_stats_t* out_stats
+) {
+    if (!session || !out_stats) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    *out_stats = session->stats;
+    return MP3_OK;
+}
+
+mp3_result_t mp3_session_get_stats(
+    const mp3_session_t* session,
+    mp3_session_stats_t* out_stats
+) {
+    if (!session || !out_stats) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    *out_stats = session->run_stats;
+
+    // Счётчики разбора ведёт движок; заглушка может их не поддерживать
+    const mp3_result_t result =
+        mp3_rust_session_get_stats_impl(session->rust_session, out_stats);
+    if (result != MP3_OK && result != MP3_ERR_NOT_IMPLEMENTED) {
+        return result;
+    }
+    return MP3_OK;
+}
+
+mp3_result_t mp3_session_get_estimate(
+    const mp3_session_t* session,
+    mp3_duration_estimate_t* out_estimate
+) {
+    if (!session || !out_estimate) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    return mp3_rust_session_get_estimate_impl(session->rust_session, out_estimate);
+}
+
+void mp3_session_cancel(mp3_session_t* session) {
+    if (session) {
+        session->cancelled.store(1);
+    }
 }
 
 void mp3_session_deinit(mp3_session_t* session) {
@@ -142,13 +1516,22 @@ void mp3_session_deinit(mp3_session_t* session) {
     }
 
     mp3_rust_session_deinit_impl(session->rust_session);
-    delete session;
+    session_release(session);
 }
 
 mp3_result_t mp3_analyze(
     mp3_detector_t* detector,
     const mp3_host_api_t* host_api,
     mp3_audio_info_t* out_info
+) {
+    return mp3_analyze_ex(detector, host_api, nullptr, out_info);
+}
+
+mp3_result_t mp3_analyze_ex(
+    mp3_detector_t* detector,
+    const mp3_host_api_t* host_api,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
 ) {
     if (!detector || !host_api || !out_info) {
         return MP3_ERR_INVALID_PTR;
@@ -161,11 +1544,64 @@ mp3_result_t mp3_analyze(
         return init_result;
     }
 
-    const mp3_result_t run_result = mp3_session_run(session, out_info);
+    const mp3_result_t run_result = mp3_session_run_ex(session, options, out_info);
     mp3_session_deinit(session);
     return run_result;
 }
 
+mp3_result_t mp3_analyze_buffer(
+    mp3_detector_t* detector,
+    const uint8_t* data,
+    size_t len,
+    mp3_audio_info_t* out_info
+) {
+    if (!detector || !out_info || (!data && len > 0)) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    return mp3_native::analyze_buffer(data, len, out_info);
+}
+
+mp3_result_t mp3_analyze_batch(
+    mp3_detector_t* detector,
+    const mp3_host_api_t* sources,
+    size_t n,
+    mp3_audio_info_t* out,
+    mp3_result_t* codes
+) {
+    if (!detector || (n > 0 && (!sources || !out))) {
+        return MP3_ERR_INVALID_PTR;
+    }
+
+    mp3_session_t* session = nullptr;
+    mp3_result_t first_error = MP3_OK;
+
+    for (size_t i = 0; i < n; ++i) {
+        mp3_result_t code;
+        if (!session) {
+            code = mp3_session_init(detector, &sources[i], &session);
+        } else {
+            code = mp3_session_reset(session, &sources[i]);
+        }
+
+        if (code == MP3_OK) {
+            code = mp3_session_run(session, &out[i]);
+        } else {
+            std::memset(&out[i], 0, sizeof(out[i]));
+        }
+
+        if (codes) {
+            codes[i] = code;
+        }
+        if (code != MP3_OK && first_error == MP3_OK) {
+            first_error = code;
+        }
+    }
+
+    mp3_session_deinit(session);
+    return first_error;
+}
+
 const char* mp3_error_string(mp3_result_t result) {
     switch (result) {
         case MP3_OK:                  return "OK";
@@ -174,8 +1610,12 @@ const char* mp3_error_string(mp3_result_t result) {
         case MP3_ERR_OUT_OF_MEMORY:   return "Out of memory";
         case MP3_ERR_IO:              return "I/O error";
         case MP3_ERR_INVALID_FORMAT:  return "Invalid MP3 format";
-        case MP3_ERR_NOT_IMPLEMENTED: return "Rust MP3 blob is not linked";
+        case MP3_ERR_NOT_IMPLEMENTED: return "Not implemented";
         case MP3_ERR_INTERNAL:        return "Internal error";
+        case MP3_ERR_NOT_FOUND:       return "Not found";
+        case MP3_ERR_PENDING:         return "Pending";
+        case MP3_ERR_CANCELLED:       return "Cancelled";
+        case MP3_ERR_TIMEOUT:         return "Timed out";
         case MP3_ERR_UNKNOWN:         return "Unknown error";
         default:                      return "Unknown error code";
     }
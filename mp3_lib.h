@@ -6,6 +6,22 @@
  * - C/C++ сторона предоставляет Rust библиотеке ручки чтения данных и памяти.
  * - Rust сторона выполняет разбор MP3 и возвращает результат.
  * - C/C++ пользователь работает через простой lifecycle: init/run/deinit.
+ *
+ * Потокобезопасность:
+ * - Детектор (mp3_detector_instance / mp3_detector_create) может
+ *   одновременно использоваться любым числом потоков: mp3_session_init,
+ *   mp3_analyze и mp3_analyze_batch безопасно вызывать параллельно с одним
+ *   детектором. Единственное изменяемое состояние — занятость слотов пула
+ *   сессий — меняется атомарно, без блокировок.
+ * - Сессия не потокобезопасна: в каждый момент с ней работает один поток.
+ *   Для параллельного анализа — своя сессия на каждый поток.
+ * - Ручки хоста вызываются только из потока, работающего с сессией.
+ *   В push-режиме (mp3_stream_feed) данные отдаёт сам хост, read_at не нужен.
+ *   В асинхронном режиме (mp3_session_run_async) mp3_session_complete
+ *   можно звать из любого потока, но не одновременно с другими вызовами
+ *   той же сессии.
+ * - mp3_session_cancel — единственный вызов, который можно делать из
+ *   другого потока одновременно с работой сессии.
  */
 
 #pragma once
@@ -31,16 +47,68 @@ typedef struct mp3_session_t mp3_session_t;
 // Результат анализа
 // ============================================================================
 
+/**
+ * @brief Режим анализа: цена против точности
+ */
+typedef enum {
+    MP3_MODE_TRUST_XING = 0,        ///< Xing/Info/VBRI, если есть; иначе CBR-проверка; иначе точный подсчёт
+    MP3_MODE_FAST_ESTIMATE = 1,     ///< Xing, если есть; иначе оценка по выборке участков файла
+    MP3_MODE_EXACT_SCAN = 2,        ///< Всегда точный подсчёт фреймов, Xing игнорируется
+    MP3_MODE_CBR_VERIFIED = 3,      ///< Только результат (mp3_audio_info_t::mode): CBR подтверждён
+                                    ///< в начале и в середине, длительность — по размеру данных
+} mp3_analyze_mode_t;
+
 typedef struct {
     uint32_t sample_rate;       ///< Частота дискретизации (Hz)
     uint16_t channels;          ///< Количество каналов (моно=1, стерео=2)
     uint16_t bits_per_sample;   ///< Бит на сэмпл (8, 16, 24, 32)
     uint32_t bitrate;           ///< Битрейт (bps)
     uint32_t duration_ms;       ///< Длительность в миллисекундах
-    uint64_t data_size;         ///< Размер аудиоданных (байт)
+    uint64_t data_size;         ///< Размер аудиоданных (байт), без тегов в начале и в конце
     uint8_t valid;              ///< Информация валидна (1=да, 0=нет)
+    uint8_t mode;               ///< Как получена длительность (mp3_analyze_mode_t)
 } mp3_audio_info_t;
 
+/**
+ * @brief Вид промежуточного результата (mp3_progress_fn)
+ */
+typedef enum {
+    MP3_PROGRESS_ESTIMATE = 0,      ///< Оценка; анализ продолжается и уточнит её
+    MP3_PROGRESS_FINAL = 1,         ///< Итог анализа: то же, что вернёт run
+} mp3_progress_kind_t;
+
+/**
+ * @brief Промежуточный результат анализа (опционально)
+ *
+ * Вызывается из потока, ведущего сессию, внутри run / step / complete /
+ * mp3_stream_feed. Оценки приходят, только пока анализ идёт дальше
+ * первого окна: в EXACT_SCAN — на время точного подсчёта, в остальных
+ * режимах — при CBR-проверке, выборке или подсчёте без Xing. Если итог
+ * готов по первому окну (Xing в TRUST_XING / FAST_ESTIMATE), приходит
+ * только MP3_PROGRESS_FINAL.
+ *
+ * Первая оценка — после первого окна с фреймом: по Xing, если он есть,
+ * иначе по размеру данных и битрейту заголовка. Во время точного
+ * подсчёта она уточняется: посчитанное плюс остаток данных по среднему
+ * размеру фрейма. Для каждой оценки берутся только уже прочитанные
+ * байты. Итог приходит один раз, после всех оценок, и только при успехе;
+ * ошибку, отмену и срок вернёт сам вызов.
+ *
+ * @param info Валиден только на время вызова
+ * @param kind mp3_progress_kind_t
+ */
+typedef void (*mp3_progress_fn)(void* progress_ctx, const mp3_audio_info_t* info, uint8_t kind);
+
+/**
+ * @brief Параметры одного запуска анализа
+ */
+typedef struct {
+    uint8_t mode;               ///< mp3_analyze_mode_t
+    mp3_progress_fn progress;   ///< Опционально: оценки (пока анализ идёт) и итог
+    void* progress_ctx;         ///< Контекст progress
+    uint64_t deadline_us;       ///< Опционально: крайний срок по clock_us хоста (абсолютный); 0 — без срока
+} mp3_analyze_options_t;
+
 typedef enum {
     MP3_OK = 0,
     MP3_ERR_INVALID_PTR = 1,
@@ -50,6 +118,10 @@ typedef enum {
     MP3_ERR_INVALID_FORMAT = 5,
     MP3_ERR_NOT_IMPLEMENTED = 6,
     MP3_ERR_INTERNAL = 7,
+    MP3_ERR_NOT_FOUND = 8,              ///< Нет записи (mp3_index.h)
+    MP3_ERR_PENDING = 9,                ///< Анализ не закончен: ждёт чтения (mp3_session_run_async)
+    MP3_ERR_CANCELLED = 10,             ///< Анализ прерван mp3_session_cancel
+    MP3_ERR_TIMEOUT = 11,               ///< Анализ прерван: прошёл deadline_us
     MP3_ERR_UNKNOWN = 255,
 } mp3_result_t;
 
@@ -76,7 +148,30 @@ typedef mp3_result_t (*mp3_read_at_fn)(
 );
 
 /**
- * @brief Выделить память для Rust-библиотеки
+ * @brief Одолжить данные источника без копирования (опционально)
+ *
+ * Хост отдаёт указатель на свою память (mmap, буфер, кэш страниц) вместо
+ * копирования в буфер парсера. Указатель должен оставаться валидным до
+ * следующего вызова любой ручки этого источника.
+ *
+ * @param offset Смещение в байтах от начала источника
+ * @param requested Сколько байт нужно
+ * @param out_data Указатель на данные хоста
+ * @param out_len Сколько байт доступно (меньше requested — только у конца источника)
+ * @return MP3_OK; MP3_ERR_NOT_IMPLEMENTED — диапазон не одолжить, читать через read_at
+ */
+typedef mp3_result_t (*mp3_borrow_at_fn)(
+    void* user_ctx,
+    uint64_t offset,
+    size_t requested,
+    const uint8_t** out_data,
+    size_t* out_len
+);
+
+/**
+ * @brief Выделить память для библиотеки
+ *
+ * Память должна быть выровнена на MP3_SESSION_STORAGE_ALIGN (malloc подходит).
  */
 typedef void* (*mp3_alloc_fn)(void* user_ctx, size_t size);
 
@@ -90,31 +185,219 @@ typedef void (*mp3_free_fn)(void* user_ctx, void* ptr);
  */
 typedef void (*mp3_log_fn)(void* user_ctx, int level, const char* msg);
 
+/**
+ * @brief Монотонные часы хоста в микросекундах (опционально)
+ *
+ * Нужны только для времени фаз в mp3_session_stats_t; без них время — 0.
+ */
+typedef uint64_t (*mp3_clock_us_fn)(void* user_ctx);
+
+/**
+ * @brief Одна задача параллельного цикла
+ *
+ * @param task_ctx Контекст, переданный в mp3_parallel_for_fn
+ * @param index Номер задачи, 0..count-1
+ */
+typedef void (*mp3_task_fn)(void* task_ctx, uint32_t index);
+
+/**
+ * @brief Выполнить count задач на потоках хоста и дождаться всех (опционально)
+ *
+ * Точный подсчёт фреймов большого файла делится на участки, которые
+ * считаются параллельно и сшиваются по границам фреймов; результат
+ * совпадает с последовательным подсчётом.
+ *
+ * Задачи независимы, порядок и распределение по потокам — на усмотрение
+ * хоста (в том числе все на вызывающем потоке). Если ручка задана,
+ * read_at и borrow_at обязаны быть потокобезопасны, а одолженный
+ * указатель — валиден до следующего вызова ручки из того же потока.
+ * С deadline_us clock_us тоже зовётся из задач.
+ */
+typedef void (*mp3_parallel_for_fn)(
+    void* parallel_ctx,
+    uint32_t count,
+    mp3_task_fn task,
+    void* task_ctx
+);
+
+/**
+ * @brief Поставить чтение в очередь хоста (опционально, асинхронный режим)
+ *
+ * Хост запускает чтение и сразу возвращает управление. Когда данные
+ * лежат в dst, он вызывает mp3_session_complete(session, ...); dst
+ * валиден до этого вызова. Завершить чтение можно и прямо внутри
+ * read_submit.
+ *
+ * @param session Сессия, которой передать результат
+ * @return MP3_OK — чтение принято; иначе анализ завершается с этой ошибкой
+ */
+typedef mp3_result_t (*mp3_read_submit_fn)(
+    void* user_ctx,
+    uint64_t offset,
+    uint8_t* dst,
+    size_t requested,
+    mp3_session_t* session
+);
+
+/// Значение mp3_host_api_t::read_ahead: окно по умолчанию
+#define MP3_READ_AHEAD_DEFAULT 0u
+/// Значение mp3_host_api_t::read_ahead: кэш выключен, каждое чтение идёт в хост
+#define MP3_READ_AHEAD_OFF 0xFFFFFFFFu
+
 /**
  * @brief Набор ручек, передаваемых в Rust-библиотеку
  */
 typedef struct {
     void* user_ctx;                 ///< Контекст источника данных (файл/буфер/стрим)
     uint64_t source_size;           ///< Полный размер источника (0 если неизвестен)
-    mp3_read_at_fn read_at;         ///< Обязательная ручка чтения
-    mp3_alloc_fn alloc;             ///< Опционально, если NULL Rust использует свой alloc
+    mp3_read_at_fn read_at;         ///< Ручка чтения; без неё — только read_submit или mp3_stream_*
+    mp3_alloc_fn alloc;             ///< Опционально, память сессии; если NULL — куча
     mp3_free_fn free;               ///< Опционально, парная к alloc
     mp3_log_fn log;                 ///< Опционально
+    uint32_t read_ahead;            ///< Окно read-ahead сессии в байтах (MP3_READ_AHEAD_*)
+    mp3_borrow_at_fn borrow_at;     ///< Опционально, чтение без копирования
+    mp3_clock_us_fn clock_us;       ///< Опционально, часы для статистики сессии
+    mp3_parallel_for_fn parallel_for; ///< Опционально, параллельный точный подсчёт
+    void* parallel_ctx;             ///< Контекст parallel_for (пул потоков хоста)
+    mp3_read_submit_fn read_submit; ///< Опционально, асинхронное чтение (mp3_session_run_async)
 } mp3_host_api_t;
 
+/**
+ * @brief Статистика read-ahead кэша сессии
+ */
+typedef struct {
+    uint32_t requests;              ///< Чтений, запрошенных парсером
+    uint32_t host_calls;            ///< Фактических вызовов host read_at
+    uint32_t saved_calls;           ///< Чтений, целиком обслуженных из кэша
+    uint64_t bytes_from_cache;      ///< Байт отдано из кэша
+    uint32_t borrowed;              ///< Чтений, отданных без копирования (borrow_at)
+} mp3_read_ahead_stats_t;
+
+/**
+ * @brief Фазы анализа (индексы mp3_session_stats_t::phase_us)
+ */
+typedef enum {
+    MP3_PHASE_ID3 = 0,              ///< Пропуск тегов: ID3v2 в начале, APEv2/ID3v1/Lyrics3 в конце
+    MP3_PHASE_SYNC = 1,             ///< Поиск первого фрейма
+    MP3_PHASE_VBR = 2,              ///< Разбор Xing/Info/VBRI
+    MP3_PHASE_SCAN = 3,             ///< Подсчёт фреймов
+    MP3_PHASE_COUNT = 4,
+} mp3_phase_t;
+
+/**
+ * @brief Статистика последнего mp3_session_run
+ *
+ * Ввод-вывод считается на границе хоста (после read-ahead кэша),
+ * т.е. это реальные обращения к источнику. Время фаз заполняется,
+ * только если хост дал clock_us.
+ */
+typedef struct {
+    uint32_t read_calls;            ///< Вызовов host read_at + borrow_at
+    uint32_t max_request;           ///< Самый большой одиночный запрос (байт)
+    uint64_t bytes_requested;       ///< Байт запрошено у хоста
+    uint64_t bytes_returned;        ///< Байт хост реально отдал
+    uint64_t frames_inspected;      ///< Разобранных заголовков фреймов
+    uint64_t id3_bytes_skipped;     ///< Байт тегов пропущено без чтения (ID3v2, APEv2, ID3v1, Lyrics3)
+    uint64_t phase_us[MP3_PHASE_COUNT]; ///< Время по фазам (мкс)
+    uint64_t total_us;              ///< Полное время run (мкс); по шагам — сумма шагов
+    uint32_t steps;                 ///< Вызовов mp3_session_step (0 — run целиком)
+    uint64_t max_step_us;           ///< Самый долгий шаг (мкс)
+} mp3_session_stats_t;
+
+/**
+ * @brief Точность длительности последнего mp3_session_run
+ *
+ * Xing/VBRI и точный подсчёт дают error_ms = 0. Оценка VBR по выборке
+ * (MP3_MODE_FAST_ESTIMATE без Xing) — 95% доверительный интервал по
+ * разбросу среднего размера фрейма между участками. Проверенный CBR —
+ * плюс-минус один фрейм.
+ */
+typedef struct {
+    uint32_t duration_ms;           ///< Как в mp3_audio_info_t
+    uint32_t error_ms;              ///< Полуширина интервала
+    uint32_t low_ms;                ///< duration_ms - error_ms
+    uint32_t high_ms;               ///< duration_ms + error_ms
+    uint32_t sample_points;         ///< Участков в выборке (0 — выборки не было)
+    uint32_t sampled_frames;        ///< Фреймов разобрано на этих участках
+} mp3_duration_estimate_t;
+
 // ============================================================================
 // Lifecycle пользовательского API (стабильный вход в Rust blob)
 // ============================================================================
 
+/// Выравнивание памяти под сессию и пул сессий
+#define MP3_SESSION_STORAGE_ALIGN 8u
+
+/**
+ * @brief Параметры детектора
+ *
+ * Откуда mp3_session_init берёт память сессии, по порядку:
+ *  1. пул — фиксированное число слотов. Память пула либо даёт хост
+ *     (session_pool, например статический буфер прошивки), либо детектор
+ *     выделяет её один раз при создании (session_pool_capacity слотов);
+ *  2. bump-арена: сессии берутся сдвигом вершины, арена целиком
+ *     сбрасывается, когда закрыта последняя живая сессия;
+ *  3. если пула и арены нет (или они заняты и разрешён heap_fallback) —
+ *     alloc/free из mp3_host_api_t сессии, а без них — куча.
+ *
+ * Собственная память детектора (заголовок, пул, арена, если их не дал
+ * хост) берётся через alloc/free конфигурации, а без них — из кучи.
+ */
+typedef struct {
+    void* session_pool;             ///< Память под детектор и пул (NULL — выделить)
+    size_t session_pool_size;       ///< Размер session_pool, см. mp3_detector_storage_size()
+    uint32_t session_pool_capacity; ///< Слотов, если session_pool == NULL (0 — без пула)
+    uint8_t heap_fallback;          ///< 1 — при занятых пуле и арене брать сессию из кучи
+    void* arena;                    ///< Память арены (NULL — выделить arena_size байт)
+    size_t arena_size;              ///< Размер арены (0 — без арены, не больше 16 MiB)
+    mp3_alloc_fn alloc;             ///< Аллокатор памяти детектора (опционально)
+    mp3_free_fn free;               ///< Парная к alloc
+    void* alloc_ctx;                ///< user_ctx для alloc/free
+} mp3_detector_config_t;
+
+/**
+ * @brief Создать детектор без пула (сессии — из кучи)
+ */
 mp3_detector_t* mp3_detector_create(void);
 
+/**
+ * @brief Создать детектор с параметрами
+ *
+ * Если задан session_pool, детектор размещается прямо в нём и куча
+ * не используется вовсе; число слотов — сколько поместится.
+ *
+ * @param config Параметры (NULL — как mp3_detector_create)
+ * @return Детектор или NULL (нет памяти, буфер мал или не выровнен)
+ */
+mp3_detector_t* mp3_detector_create_ex(const mp3_detector_config_t* config);
+
+/**
+ * @brief Уничтожить детектор
+ *
+ * Все сессии детектора должны быть уже закрыты. Буфер session_pool
+ * после вызова снова принадлежит хосту.
+ */
 void mp3_detector_destroy(mp3_detector_t* detector);
 
+/**
+ * @brief Сколько байт нужно session_pool для пула из capacity слотов
+ */
+size_t mp3_detector_storage_size(uint32_t capacity);
+
+/**
+ * @brief Общий детектор процесса
+ *
+ * Статический объект без изменяемого состояния: инициализации не требует,
+ * безопасен для одновременного использования из разных потоков.
+ */
 mp3_detector_t* mp3_detector_instance(void);
 
 /**
  * @brief Инициализировать сессию анализа
  *
+ * Сессия берётся из пула детектора, а если пула нет (или он занят
+ * и разрешён heap_fallback) — одной аллокацией из кучи.
+ *
  * @param detector Детектор, полученный через create/instance
  * @param host_api Набор callback-ручек хоста
  * @param out_session Выходная сессия
@@ -127,15 +410,245 @@ mp3_result_t mp3_session_init(
 );
 
 /**
- * @brief Выполнить анализ MP3 в Rust-библиотеке
+ * @brief Сколько байт нужно под одну сессию (bridge + движок)
+ */
+size_t mp3_session_storage_size(void);
+
+/**
+ * @brief Инициализировать сессию в памяти вызывающего
+ *
+ * Ни одной аллокации: сессия и состояние движка лежат в storage.
+ * mp3_session_deinit() разрушает сессию, но память не освобождает.
+ *
+ * @param storage Буфер не меньше mp3_session_storage_size(),
+ *                выровненный на MP3_SESSION_STORAGE_ALIGN
+ * @param storage_size Размер буфера
+ * @return MP3_ERR_INVALID_ARG, если буфер мал или не выровнен
+ */
+mp3_result_t mp3_session_init_inplace(
+    mp3_detector_t* detector,
+    const mp3_host_api_t* host_api,
+    void* storage,
+    size_t storage_size,
+    mp3_session_t** out_session
+);
+
+/**
+ * @brief Выполнить анализ MP3 в Rust-библиотеке (MP3_MODE_TRUST_XING)
  */
 mp3_result_t mp3_session_run(mp3_session_t* session, mp3_audio_info_t* out_info);
 
+/**
+ * @brief Выполнить анализ с выбранным режимом
+ *
+ * Фактически использованный способ возвращается в out_info->mode:
+ * например, FAST_ESTIMATE без известного размера источника
+ * откатывается к EXACT_SCAN.
+ *
+ * Анализ прерывается по mp3_session_cancel() или, если задан
+ * options->deadline_us, когда clock_us хоста его достигнет (срок
+ * проверяется перед каждым обращением к хосту). Тогда возвращается
+ * MP3_ERR_CANCELLED / MP3_ERR_TIMEOUT, а в out_info — лучшая оценка
+ * по уже разобранному (mode = MP3_MODE_FAST_ESTIMATE; valid = 0, если
+ * первый фрейм не найден или движок оценок не даёт). Так же ведут себя
+ * mp3_session_step, mp3_session_complete и mp3_stream_*.
+ *
+ * @param options Параметры (NULL — по умолчанию)
+ * @return MP3_ERR_INVALID_ARG — у хоста нет read_at, идёт асинхронный
+ *         анализ или задан deadline_us без clock_us
+ */
+mp3_result_t mp3_session_run_ex(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Начать анализ по шагам (mp3_session_step)
+ *
+ * Для кооперативных планировщиков: анализ идёт порциями ограниченного
+ * размера, между которыми задача отдаёт управление.
+ *
+ * @return MP3_ERR_NOT_IMPLEMENTED — движок (заглушка Rust) по шагам не умеет
+ */
+mp3_result_t mp3_session_begin(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options
+);
+
+/**
+ * @brief Продвинуть анализ, начатый mp3_session_begin, на ограниченную работу
+ *
+ * Читает и разбирает не больше budget_bytes источника, округлённых вверх
+ * до окна чтения (4 KiB), и возвращается; следующий вызов продолжает
+ * ровно с места остановки. Работа шага линейна по прочитанным байтам,
+ * поэтому время шага ограничено бюджетом; самый долгий шаг — в
+ * mp3_session_stats_t::max_step_us. mp3_session_run — тот же цикл
+ * шагов без ограничения.
+ *
+ * @param budget_bytes Бюджет шага; 0 — одно окно
+ * @param out_done 1 — анализ закончен: out_info заполнен, возвращён итог
+ * @return MP3_OK, пока анализ не закончен (*out_done = 0); иначе итог.
+ *         MP3_ERR_INVALID_ARG — анализ не начат
+ */
+mp3_result_t mp3_session_step(
+    mp3_session_t* session,
+    uint32_t budget_bytes,
+    uint8_t* out_done,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Начать анализ без блокировки на вводе-выводе
+ *
+ * Каждое чтение уходит в read_submit хоста, и вызов возвращается
+ * с MP3_ERR_PENDING. Получив данные, хост вызывает mp3_session_complete(),
+ * и разбор продолжается с места остановки. Один поток может так вести
+ * любое число сессий, по одному чтению в полёте на каждую.
+ *
+ * Если у хоста нет read_submit (или движок не умеет работать по шагам),
+ * анализ идёт через read_at и заканчивается внутри вызова, как
+ * mp3_session_run_ex(). Время фаз в статистике включает ожидание чтений.
+ *
+ * @return MP3_ERR_PENDING — ждёт чтения; иначе итог анализа (out_info заполнен)
+ */
+mp3_result_t mp3_session_run_async(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Отдать сессии результат чтения, запрошенного через read_submit
+ *
+ * @param read_result Код чтения; не MP3_OK — анализ завершается с ним
+ * @param read_len Сколько байт записано в dst (меньше requested — конец источника)
+ * @return MP3_ERR_PENDING — отправлено следующее чтение; иначе итог анализа
+ *         (out_info заполнен). Вызов изнутри read_submit всегда возвращает
+ *         MP3_ERR_PENDING — итог вернёт внешний вызов.
+ *         MP3_ERR_INVALID_ARG — у сессии нет чтения в полёте.
+ */
+mp3_result_t mp3_session_complete(
+    mp3_session_t* session,
+    mp3_result_t read_result,
+    size_t read_len,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Начать push-анализ: хост сам отдаёт байты источника по порядку
+ *
+ * Для источников без произвольного доступа: pipe, stdin, приём по сети,
+ * идущая запись. Байты передаются через mp3_stream_feed() порциями любого
+ * размера, конец потока — mp3_stream_finish(). Сессия хранит только
+ * недособранное окно движка (меньше 4 KiB), поэтому память не зависит
+ * от длины потока; пропускаемые байты (ID3v2, хвост после конца анализа)
+ * не копируются.
+ *
+ * Размер источника считается неизвестным: теги в конце не отрезаются,
+ * FAST_ESTIMATE и TRUST_XING без Xing дают точный подсчёт. С Xing
+ * (TRUST_XING) анализ заканчивается на первом фрейме, остальные байты
+ * отбрасываются.
+ *
+ * @return MP3_ERR_INVALID_ARG — у хоста задан source_size или идёт
+ *         асинхронный анализ; MP3_ERR_NOT_IMPLEMENTED — движок (заглушка
+ *         Rust) по шагам не умеет
+ */
+mp3_result_t mp3_stream_begin(
+    mp3_session_t* session,
+    const mp3_analyze_options_t* options
+);
+
+/**
+ * @brief Отдать следующие len байт потока
+ *
+ * data нужен только на время вызова. Время фаз в статистике считается
+ * внутри вызовов; read_calls и bytes_returned — вызовы и байты feed.
+ *
+ * @param out_info Текущая длительность (опционально): итог, если анализ
+ *                 уже закончен, иначе по насчитанным фреймам; valid = 0,
+ *                 пока первый фрейм не найден
+ * @return MP3_OK, пока поток принимается; ошибка — анализ прерван с ней
+ *         (например, MP3_ERR_INVALID_FORMAT: фрейма нет в первом 1 MiB).
+ *         MP3_ERR_INVALID_ARG — push-анализ не начат
+ */
+mp3_result_t mp3_stream_feed(
+    mp3_session_t* session,
+    const uint8_t* data,
+    size_t len,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Конец потока: итог push-анализа
+ *
+ * Недособранное окно разбирается как конец источника (последний фрейм
+ * может быть обрезан). После вызова сессию можно снова запускать.
+ *
+ * @return Итог анализа; MP3_ERR_INVALID_ARG — push-анализ не начат
+ */
+mp3_result_t mp3_stream_finish(mp3_session_t* session, mp3_audio_info_t* out_info);
+
+/**
+ * @brief Прервать идущий анализ сессии
+ *
+ * Можно звать из любого потока, в том числе из progress и ручек хоста.
+ * Анализ останавливается перед следующим чтением и возвращает
+ * MP3_ERR_CANCELLED с лучшей оценкой (см. mp3_session_run_ex). Чтение,
+ * уже отправленное через read_submit, отменяет сам хост (или дожидается
+ * его и зовёт mp3_session_complete). Отмена не снимается запуском:
+ * вызов между анализами прерывает следующий сразу. Снимает её только
+ * mp3_session_reset() (новая сессия не отменена).
+ */
+void mp3_session_cancel(mp3_session_t* session);
+
 /**
  * @brief Завершить работу сессии и освободить ресурсы
+ *
+ * Слот пула возвращается детектору; память mp3_session_init_inplace
+ * снова принадлежит вызывающему. Чтения в полёте (read_submit) должны
+ * быть завершены или отменены хостом до вызова.
  */
 void mp3_session_deinit(mp3_session_t* session);
 
+/**
+ * @brief Перенастроить сессию на новый источник без пересоздания
+ *
+ * Аллокации и внутренние буферы сессии переиспользуются;
+ * read-ahead кэш и его статистика сбрасываются.
+ * MP3_ERR_INVALID_ARG — у сессии чтение в полёте (mp3_session_run_async).
+ */
+mp3_result_t mp3_session_reset(mp3_session_t* session, const mp3_host_api_t* host_api);
+
+/**
+ * @brief Статистика read-ahead кэша с момента init/reset сессии
+ */
+mp3_result_t mp3_session_get_read_ahead_stats(
+    const mp3_session_t* session,
+    mp3_read_ahead_stats_t* out_stats
+);
+
+/**
+ * @brief Статистика ввода-вывода и времени последнего mp3_session_run
+ *
+ * Если движок не ведёт счётчики разбора (заглушка Rust), frames_inspected,
+ * id3_bytes_skipped и phase_us остаются нулевыми.
+ */
+mp3_result_t mp3_session_get_stats(
+    const mp3_session_t* session,
+    mp3_session_stats_t* out_stats
+);
+
+/**
+ * @brief Расширенный результат последнего mp3_session_run: точность длительности
+ *
+ * MP3_ERR_NOT_IMPLEMENTED — движок (заглушка Rust) интервал не считает.
+ */
+mp3_result_t mp3_session_get_estimate(
+    const mp3_session_t* session,
+    mp3_duration_estimate_t* out_estimate
+);
+
 /**
  * @brief Удобная одношаговая функция: init -> run -> deinit
  */
@@ -145,6 +658,52 @@ mp3_result_t mp3_analyze(
     mp3_audio_info_t* out_info
 );
 
+/**
+ * @brief Одношаговая функция с выбранным режимом (см. mp3_session_run_ex)
+ */
+mp3_result_t mp3_analyze_ex(
+    mp3_detector_t* detector,
+    const mp3_host_api_t* host_api,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Анализ MP3, уже целиком лежащего в памяти
+ *
+ * Разбор идёт прямо по data: без ручек хоста, копирования и аллокаций.
+ * Всегда использует нативный движок, даже если слинкован Rust blob.
+ *
+ * @param data Начало источника
+ * @param len Размер источника в байтах
+ */
+mp3_result_t mp3_analyze_buffer(
+    mp3_detector_t* detector,
+    const uint8_t* data,
+    size_t len,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Пакетный анализ: одна сессия на все источники
+ *
+ * Сессия создаётся один раз и переиспользуется через mp3_session_reset(),
+ * поэтому накладные расходы на файл сводятся к самому разбору.
+ *
+ * @param sources Массив из n наборов ручек хоста
+ * @param n Количество источников
+ * @param out Массив из n результатов
+ * @param codes Массив из n кодов результата (опционально, может быть NULL)
+ * @return MP3_OK, если все источники разобраны; иначе код первой ошибки
+ */
+mp3_result_t mp3_analyze_batch(
+    mp3_detector_t* detector,
+    const mp3_host_api_t* sources,
+    size_t n,
+    mp3_audio_info_t* out,
+    mp3_result_t* codes
+);
+
 // ============================================================================
 // Утилиты
 // ============================================================================
@@ -0,0 +1,1400 @@
+/**
+ * @file mp3_native.cpp
+ * @brief Нативный C++ движок разбора MPEG-фреймов
+ *
+ * Табличный разбор заголовков MPEG-1/2/2.5 Layer I/II/III,
+ * пропуск ID3v2 в начале и APEv2/ID3v1/Lyrics3 в конце по их размерам,
+ * чтение Xing/Info/VBRI и точный подсчёт фреймов,
+ * если VBR-заголовка нет. Память не выделяется; если хост умеет
+ * borrow_at, данные разбираются прямо в его памяти без копирования.
+ */
+
+#include "mp3_native.h"
+
+#include <cstring>
+
+namespace mp3_native {
+
+namespace {
+
+// ============================================================================
+// Таблицы
+// ============================================================================
+
+/// Биты версии заголовка -> mpeg_version_t (1 — зарезервировано)
+constexpr uint8_t VERSION_RESERVED = 0xFF;
+constexpr uint8_t kVersionByBits[4] = {MPEG_25, VERSION_RESERVED, MPEG_2, MPEG_1};
+
+/// Битрейт, kbps: [MPEG-1 / MPEG-2,2.5][layer - 1][index]
+constexpr uint16_t kBitrateKbps[2][3][16] = {
+    {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},
+    },
+    {
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+    },
+};
+
+/// Частота дискретизации, Hz: [mpeg_version_t][index]
+constexpr uint32_t kSampleRate[3][3] = {
+    {44100, 48000, 32000},
+    {22050, 24000, 16000},
+    {11025, 12000, 8000},
+};
+
+/// Сэмплов на фрейм: [MPEG-1 / MPEG-2,2.5][layer - 1]
+constexpr uint16_t kSamplesPerFrame[2][3] = {
+    {384, 1152, 1152},
+    {384, 1152, 576},
+};
+
+/// Размер side info Layer III: [MPEG-1 / MPEG-2,2.5][моно / стерео]
+constexpr uint8_t kSideInfoSize[2][2] = {
+    {17, 32},
+    {9, 17},
+};
+
+/// Смещение VBRI-заголовка от начала фрейма (фиксированное)
+constexpr size_t VBRI_OFFSET = 4 + 32;
+constexpr size_t VBRI_SIZE = 18;
+
+/// Достаточно для Xing (тег + флаги + frames + bytes) при любом side info
+constexpr size_t VBR_PROBE_SIZE = VBRI_OFFSET + VBRI_SIZE;
+
+constexpr size_t ID3V2_HEADER_SIZE = 10;
+constexpr uint8_t ID3V2_FLAG_FOOTER = 0x10;
+
+constexpr size_t ID3V1_SIZE = 128;
+constexpr size_t ID3V1_ENHANCED_SIZE = 227;     ///< "TAG+" перед ID3v1
+constexpr size_t APE_FOOTER_SIZE = 32;
+constexpr uint32_t APE_FLAG_HAS_HEADER = 0x80000000u;
+constexpr size_t LYRICS3_END_SIZE = 9;          ///< "LYRICSEND" / "LYRICS200"
+constexpr size_t LYRICS3_BEGIN_SIZE = 11;       ///< "LYRICSBEGIN"
+constexpr size_t LYRICS3V1_MAX_SIZE = 5100 + LYRICS3_BEGIN_SIZE + LYRICS3_END_SIZE;
+/// Остаток окна, в котором виден любой футер, кроме начала Lyrics3 v1
+constexpr size_t TAIL_MIN_WINDOW = ID3V1_SIZE + ID3V1_ENHANCED_SIZE;
+
+uint32_t read_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) |
+           static_cast<uint32_t>(p[3]);
+}
+
+uint64_t isqrt(uint64_t v) {
+    uint64_t r = 0;
+    for (uint64_t bit = uint64_t(1) << 62; bit; bit >>= 2) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+    }
+    return r;
+}
+
+/// Квантиль Стьюдента t(0.975, df) * 1000; после df = 10 — приближение
+uint64_t student_t975_x1000(uint64_t df) {
+    static constexpr uint16_t kTable[] = {
+        12706, 4303, 3182, 2776, 2571, 2447, 2365, 2306, 2262, 2228,
+    };
+    if (df == 0) {
+        return 0;
+    }
+    if (df <= sizeof(kTable) / sizeof(kTable[0])) {
+        return kTable[df - 1];
+    }
+    return 1960 + 2400 / df;
+}
+
+uint32_t read_le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/**
+ * Полный размер ID3v2 по заголовку ("ID3") или футеру ("3DI"); 0 — не тег.
+ * Размер syncsafe и уже включает расширенный заголовок; футер (v2.4) — нет.
+ */
+uint64_t id3v2_tag_size(const uint8_t* h, const char* magic) {
+    if (std::memcmp(h, magic, 3) != 0 || h[3] < 2 || h[3] > 4 || h[4] == 0xFF ||
+        ((h[6] | h[7] | h[8] | h[9]) & 0x80) != 0) {
+        return 0;
+    }
+    const uint32_t size = (static_cast<uint32_t>(h[6]) << 21) |
+                          (static_cast<uint32_t>(h[7]) << 14) |
+                          (static_cast<uint32_t>(h[8]) << 7) |
+                          static_cast<uint32_t>(h[9]);
+    const bool footer = h[3] == 4 && (h[5] & ID3V2_FLAG_FOOTER);
+    return ID3V2_HEADER_SIZE + size + (footer ? ID3V2_HEADER_SIZE : 0);
+}
+
+/**
+ * Размер последнего тега, которым заканчиваются len байт по адресу p;
+ * 0 — тега нет. Размер берётся из футера тега и может быть больше len.
+ */
+uint64_t trailer_size(const uint8_t* p, size_t len) {
+    const uint8_t* end = p + len;
+
+    if (len >= ID3V1_SIZE && std::memcmp(end - ID3V1_SIZE, "TAG", 3) == 0) {
+        const size_t full = ID3V1_SIZE + ID3V1_ENHANCED_SIZE;
+        if (len >= full && std::memcmp(end - full, "TAG+", 4) == 0) {
+            return full;
+        }
+        return ID3V1_SIZE;
+    }
+
+    if (len >= APE_FOOTER_SIZE && std::memcmp(end - APE_FOOTER_SIZE, "APETAGEX", 8) == 0) {
+        // Размер в футере считает элементы и футер, но не заголовок
+        const uint8_t* footer = end - APE_FOOTER_SIZE;
+        const uint32_t size = read_le32(footer + 12);
+        const uint32_t flags = read_le32(footer + 20);
+        if (size < APE_FOOTER_SIZE) {
+            return 0;
+        }
+        return static_cast<uint64_t>(size) + ((flags & APE_FLAG_HAS_HEADER) ? APE_FOOTER_SIZE : 0);
+    }
+
+    if (len >= LYRICS3_END_SIZE + 6 && std::memcmp(end - LYRICS3_END_SIZE, "LYRICS200", 9) == 0) {
+        // Lyrics3 v2: шесть десятичных цифр — размер от LYRICSBEGIN до них
+        uint32_t size = 0;
+        for (const uint8_t* d = end - LYRICS3_END_SIZE - 6; d < end - LYRICS3_END_SIZE; ++d) {
+            if (*d < '0' || *d > '9') {
+                return 0;
+            }
+            size = size * 10 + (*d - '0');
+        }
+        return size < LYRICS3_BEGIN_SIZE ? 0 : size + 6 + LYRICS3_END_SIZE;
+    }
+
+    if (len >= LYRICS3_END_SIZE + LYRICS3_BEGIN_SIZE &&
+        std::memcmp(end - LYRICS3_END_SIZE, "LYRICSEND", 9) == 0) {
+        // Lyrics3 v1 размера не хранит — ищем LYRICSBEGIN не дальше 5100 байт текста
+        const size_t span = len < LYRICS3V1_MAX_SIZE ? len : LYRICS3V1_MAX_SIZE;
+        for (size_t back = LYRICS3_END_SIZE + LYRICS3_BEGIN_SIZE; back <= span; ++back) {
+            if (std::memcmp(end - back, "LYRICSBEGIN", LYRICS3_BEGIN_SIZE) == 0) {
+                return back;
+            }
+        }
+        return 0;
+    }
+
+    if (len >= ID3V2_HEADER_SIZE) {
+        // ID3v2.4, дописанный в конец, опознаётся по футеру
+        return id3v2_tag_size(end - ID3V2_HEADER_SIZE, "3DI");
+    }
+    return 0;
+}
+
+} // namespace
+
+// ============================================================================
+// Заголовки
+// ============================================================================
+
+bool parse_frame_header(const uint8_t* p, frame_header_t* out) {
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+
+    const uint8_t version = kVersionByBits[(p[1] >> 3) & 0x03];
+    const uint8_t layer_bits = (p[1] >> 1) & 0x03;
+    const uint8_t bitrate_index = p[2] >> 4;
+    const uint8_t rate_index = (p[2] >> 2) & 0x03;
+    const uint8_t emphasis = p[3] & 0x03;
+
+    if (version == VERSION_RESERVED || layer_bits == 0 || rate_index == 3 ||
+        emphasis == 2) {
+        return false;
+    }
+
+    const uint8_t layer = 4 - layer_bits;
+    const uint8_t lsf = (version == MPEG_1) ? 0 : 1;
+    const uint32_t bitrate = kBitrateKbps[lsf][layer - 1][bitrate_index] * 1000u;
+    if (bitrate == 0) {
+        return false;   // free-format или запрещённый индекс
+    }
+
+    const uint32_t sample_rate = kSampleRate[version][rate_index];
+    const uint32_t samples = kSamplesPerFrame[lsf][layer - 1];
+    const uint8_t padding = (p[2] >> 1) & 0x01;
+
+    uint32_t frame_size;
+    if (layer == 1) {
+        frame_size = (12u * bitrate / sample_rate + padding) * 4u;
+    } else {
+        frame_size = (samples / 8u) * bitrate / sample_rate + padding;
+    }
+
+    out->version = version;
+    out->layer = layer;
+    out->channels = ((p[3] >> 6) == 3) ? 1 : 2;
+    out->padding = padding;
+    out->bitrate = bitrate;
+    out->sample_rate = sample_rate;
+    out->frame_size = frame_size;
+    out->samples = samples;
+    return true;
+}
+
+bool same_stream(const frame_header_t& a, const frame_header_t& b) {
+    return a.version == b.version &&
+           a.layer == b.layer &&
+           a.sample_rate == b.sample_rate;
+}
+
+size_t vbr_probe_size(const frame_header_t& hdr) {
+    return (hdr.frame_size < VBR_PROBE_SIZE) ? hdr.frame_size : VBR_PROBE_SIZE;
+}
+
+bool parse_vbr_header(
+    const uint8_t* frame,
+    size_t len,
+    const frame_header_t& hdr,
+    vbr_header_t* out
+) {
+    std::memset(out, 0, sizeof(*out));
+
+    if (hdr.layer == 3) {
+        const size_t off =
+            4 + kSideInfoSize[hdr.version == MPEG_1 ? 0 : 1][hdr.channels == 2 ? 1 : 0];
+        if (off + 8 <= len) {
+            const uint8_t* tag = frame + off;
+            const bool xing = std::memcmp(tag, "Xing", 4) == 0;
+            const bool info = std::memcmp(tag, "Info", 4) == 0;
+            if (xing || info) {
+                const uint32_t flags = read_be32(tag + 4);
+                size_t field = off + 8;
+                if ((flags & 0x01) && field + 4 <= len) {
+                    out->frames = read_be32(frame + field);
+                    field += 4;
+                }
+                if ((flags & 0x02) && field + 4 <= len) {
+                    out->bytes = read_be32(frame + field);
+                }
+                out->kind = xing ? VBR_XING : VBR_INFO;
+                return true;
+            }
+        }
+    }
+
+    if (VBRI_OFFSET + VBRI_SIZE <= len &&
+        std::memcmp(frame + VBRI_OFFSET, "VBRI", 4) == 0) {
+        out->bytes = read_be32(frame + VBRI_OFFSET + 10);
+        out->frames = read_be32(frame + VBRI_OFFSET + 14);
+        out->kind = VBR_VBRI;
+        return true;
+    }
+
+    return false;
+}
+
+// ============================================================================
+// Анализатор
+// ============================================================================
+
+void analyzer_t::reset(uint64_t size, uint8_t analyze_mode) {
+    std::memset(this, 0, sizeof(*this));
+    phase = PHASE_ID3V2;
+    mode = analyze_mode;
+    error = MP3_OK;
+    source_size = size;
+    data_end = size;
+    request_size = MP3_NATIVE_SCRATCH_SIZE;
+}
+
+bool analyzer_t::pending(request_t* req) const {
+    if (phase == PHASE_DONE || phase == PHASE_FAILED) {
+        return false;
+    }
+    req->offset = pos;
+    req->size = request_size;
+    return true;
+}
+
+void analyzer_t::fail(mp3_result_t code) {
+    if (phase != PHASE_FAILED) {
+        failed_phase = phase;
+    }
+    error = code;
+    phase = PHASE_FAILED;
+}
+
+size_t analyzer_t::avail(uint64_t offset) const {
+    if (offset < win_offset || offset >= win_offset + win_len) {
+        return 0;
+    }
+    return static_cast<size_t>(win_offset + win_len - offset);
+}
+
+const uint8_t* analyzer_t::at(uint64_t offset) const {
+    return win + (offset - win_offset);
+}
+
+/**
+ * Сдвинуть offset к следующему кандидату sync, у которого в окне есть все
+ * 4 байта заголовка. Нет кандидата — false и offset = win_end - 3: с этой
+ * позиции поиск продолжается в следующем окне.
+ */
+bool analyzer_t::seek_sync(uint64_t* offset) const {
+    const uint64_t win_end = win_offset + win_len;
+    if (*offset + 4 > win_end) {
+        return false;
+    }
+
+    // Кандидат i проверяет байты i и i + 1, поэтому span = n - 2 даёт i <= n - 4
+    const size_t span = static_cast<size_t>(win_end - *offset) - 2;
+    const size_t hit = find_sync(at(*offset), span);
+    if (hit == span) {
+        *offset = win_end - 3;
+        return false;
+    }
+    *offset += hit;
+    return true;
+}
+
+analyzer_t::step_t analyzer_t::need(uint64_t offset) {
+    pos = offset;
+    return STEP_NEED_DATA;
+}
+
+void analyzer_t::feed(const uint8_t* data, size_t len) {
+    if (phase == PHASE_DONE || phase == PHASE_FAILED) {
+        return;
+    }
+
+    // Теги в конце отрезаны: data_end для анализатора — конец источника
+    if (data_end && pos < data_end && len > data_end - pos) {
+        len = static_cast<size_t>(data_end - pos);
+    }
+
+    win = data;
+    win_offset = pos;
+    win_len = len;
+    win_eof = (len < request_size) ||
+              (data_end && pos + len >= data_end);
+
+    step_t step = STEP_CONTINUE;
+    while (step == STEP_CONTINUE) {
+        switch (phase) {
+            case PHASE_ID3V2:  step = step_id3v2();  break;
+            case PHASE_SYNC:   step = step_sync();   break;
+            case PHASE_VBR:    step = step_vbr();    break;
+            case PHASE_SCAN:   step = step_scan();   break;
+            case PHASE_TAIL:   step = step_tail();   break;
+            case PHASE_CBR:    step = step_cbr();    break;
+            case PHASE_SAMPLE: step = step_sample(); break;
+            default:           step = STEP_NEED_DATA; break;
+        }
+    }
+
+    win = nullptr;
+    win_len = 0;
+}
+
+/**
+ * Подтвердить кандидата: следующий фрейм должен начинаться с совместимого
+ * заголовка. Если следующий заголовок за пределами окна — либо нужно
+ * дочитать (need_more), либо это конец источника и кандидат принимается.
+ */
+bool analyzer_t::confirm_next(
+    uint64_t offset,
+    const frame_header_t& hdr,
+    bool* need_more
+) const {
+    *need_more = false;
+    const uint64_t next = offset + hdr.frame_size;
+    if (avail(next) >= 4) {
+        frame_header_t next_hdr;
+        return parse_frame_header(at(next), &next_hdr) && same_stream(hdr, next_hdr);
+    }
+    if (win_eof) {
+        return next >= win_offset + win_len;
+    }
+    *need_more = true;
+    return false;
+}
+
+analyzer_t::step_t analyzer_t::step_id3v2() {
+    const size_t have = avail(pos);
+    if (have < ID3V2_HEADER_SIZE && !win_eof) {
+        return need(pos);
+    }
+
+    // Тег пропускается по размеру из заголовка: содержимое (обложки и т.п.)
+    // не читается, следующий запрос — сразу за тегом. Теги могут идти подряд.
+    if (have >= ID3V2_HEADER_SIZE) {
+        const uint64_t size = id3v2_tag_size(at(pos), "ID3");
+        if (size) {
+            pos += size;
+            id3_bytes_skipped += size;
+            return avail(pos) ? STEP_CONTINUE : need(pos);
+        }
+    }
+
+    phase = PHASE_SYNC;
+    sync_origin = pos;
+    return STEP_CONTINUE;
+}
+
+analyzer_t::step_t analyzer_t::step_sync() {
+    uint64_t offset = pos;
+
+    if (avail(offset) == 0) {
+        if (win_eof) {
+            fail(MP3_ERR_INVALID_FORMAT);
+            return STEP_NEED_DATA;
+        }
+        return need(offset);
+    }
+
+    for (; seek_sync(&offset); ++offset) {
+        if (offset - sync_origin > MP3_NATIVE_MAX_SYNC_SEARCH) {
+            fail(MP3_ERR_INVALID_FORMAT);
+            return STEP_NEED_DATA;
+        }
+
+        frame_header_t hdr;
+        if (!parse_frame_header(at(offset), &hdr)) {
+            continue;
+        }
+        frames_inspected++;
+
+        bool need_more = false;
+        if (!confirm_next(offset, hdr, &need_more)) {
+            if (need_more && offset > win_offset) {
+                return need(offset);
+            }
+            continue;
+        }
+
+        first = hdr;
+        audio_start = offset;
+        pos = offset;
+        phase = PHASE_VBR;
+        return STEP_CONTINUE;
+    }
+
+    if (win_eof) {
+        fail(MP3_ERR_INVALID_FORMAT);
+        return STEP_NEED_DATA;
+    }
+
+    // offset == win_end - 3: перекрытие, чтобы не потерять заголовок на границе окон
+    if (offset - sync_origin > MP3_NATIVE_MAX_SYNC_SEARCH) {
+        fail(MP3_ERR_INVALID_FORMAT);
+        return STEP_NEED_DATA;
+    }
+    return need(offset);
+}
+
+analyzer_t::step_t analyzer_t::step_vbr() {
+    const size_t probe = vbr_probe_size(first);
+    if (avail(audio_start) < probe && !win_eof) {
+        return need(audio_start);
+    }
+
+    const size_t len = avail(audio_start) < probe ? avail(audio_start) : probe;
+    const bool has_vbr = parse_vbr_header(at(audio_start), len, first, &vbr);
+
+    // Фрейм Info (в том числе с испорченным тегом) кодируется со своим
+    // битрейтом — номинальный берём у следующего фрейма
+    nominal_bitrate = first.bitrate;
+    frame_header_t next;
+    const uint64_t next_offset = audio_start + first.frame_size;
+    if (avail(next_offset) >= 4 && parse_frame_header(at(next_offset), &next) &&
+        same_stream(first, next)) {
+        nominal_bitrate = next.bitrate;
+    }
+
+    // Размер аудиоданных из заголовка — теги в конце не нужны
+    if (has_vbr && vbr.frames > 0 && mode != MP3_MODE_EXACT_SCAN) {
+        mode_used = MP3_MODE_TRUST_XING;
+        if (vbr.bytes || !source_size) {
+            phase = PHASE_DONE;
+            return STEP_NEED_DATA;
+        }
+        phase = PHASE_TAIL;
+        return STEP_CONTINUE;
+    }
+
+    // VBR-заголовка нет (или в нём нет числа фреймов). Фрейм с Xing/VBRI
+    // не несёт звука и не учитывается: звук начинается за ним.
+    audio_end = (vbr.kind != VBR_NONE) ? audio_start + first.frame_size : audio_start;
+
+    // Оценка по выборке — только если известен размер источника
+    if (mode == MP3_MODE_FAST_ESTIMATE && source_size > audio_start) {
+        mode_used = MP3_MODE_FAST_ESTIMATE;
+        phase = PHASE_TAIL;
+        return STEP_CONTINUE;
+    }
+
+    // Длительность по размеру — только если CBR подтвердится
+    if (mode == MP3_MODE_TRUST_XING && source_size > audio_start) {
+        mode_used = MP3_MODE_CBR_VERIFIED;
+        cbr_stage = CBR_START;
+        cbr_pos = audio_end;
+        phase = PHASE_CBR;
+        return STEP_CONTINUE;
+    }
+
+    // Точный подсчёт; сначала отрезаем теги в конце, чтобы скан остановился перед ними
+    mode_used = MP3_MODE_EXACT_SCAN;
+    pos = audio_end;
+    phase = source_size ? PHASE_TAIL : PHASE_SCAN;
+    return STEP_CONTINUE;
+}
+
+analyzer_t::step_t analyzer_t::step_scan() {
+    const uint64_t win_end = win_offset + win_len;
+
+    if (avail(pos) == 0 && !win_eof) {
+        return need(pos);
+    }
+
+    while (pos + 4 <= win_end) {
+        frame_header_t hdr;
+        if (!resyncing) {
+            // Граница участка параллельного скана: дальше считает следующий
+            if (scan_stop && pos >= scan_stop) {
+                phase = PHASE_DONE;
+                return STEP_NEED_DATA;
+            }
+            if (parse_frame_header(at(pos), &hdr) && same_stream(first, hdr)) {
+                frames_inspected++;
+                // Битрейт потока — по первому звуковому фрейму, не по Xing/Info
+                if (frames == 0) {
+                    nominal_bitrate = hdr.bitrate;
+                    scan_first = pos;
+                } else if (hdr.bitrate != nominal_bitrate) {
+                    variable_bitrate = 1;
+                }
+                frames++;
+                samples += hdr.samples;
+                pos += hdr.frame_size;
+                audio_end = pos;
+                continue;
+            }
+            resyncing = 1;
+            pos++;
+        }
+
+        // Рассинхронизация: ищем следующий подтверждённый фрейм потока.
+        // Состояние переживает смену окна, поэтому результат зависит
+        // только от данных, а не от того, где начинались окна.
+        uint64_t offset = pos;
+        bool found = false;
+        for (; seek_sync(&offset); ++offset) {
+            if (!parse_frame_header(at(offset), &hdr) || !same_stream(first, hdr)) {
+                continue;
+            }
+            frames_inspected++;
+            bool need_more = false;
+            if (confirm_next(offset, hdr, &need_more)) {
+                found = true;
+                break;
+            }
+            if (need_more) {
+                return need(offset);
+            }
+        }
+        pos = offset;
+        if (!found) {
+            if (win_eof) {
+                break;
+            }
+            return need(pos);
+        }
+        resyncing = 0;
+    }
+
+    if (win_eof) {
+        if (audio_end > win_end) {
+            audio_end = win_end;   // последний фрейм обрезан
+        }
+        phase = PHASE_DONE;
+        return STEP_NEED_DATA;
+    }
+    return need(pos);
+}
+
+/**
+ * Отрезать теги в конце источника (ID3v1, APEv2, Lyrics3, ID3v2 с футером),
+ * сдвигая data_end по их футерам. Читается одно окно request_size байт,
+ * заканчивающееся на data_end; следующий футер ищется в его остатке,
+ * и новое окно читается, только если остаток слишком мал. Теги могут
+ * идти в любом порядке.
+ */
+analyzer_t::step_t analyzer_t::step_tail() {
+    // Ниже первого фрейма тег заканчиваться не может
+    const uint64_t floor = audio_start + first.frame_size;
+
+    while (data_end > floor) {
+        const uint64_t start =
+            (data_end - floor > request_size) ? data_end - request_size : floor;
+
+        // После отрезанного тега окно по-прежнему кончается за data_end:
+        // его остатка хватает на следующий футер, перечитывать не нужно
+        uint64_t from = start;
+        if (win_offset > start && win_offset < data_end && win_offset + win_len >= data_end &&
+            data_end - win_offset >= TAIL_MIN_WINDOW) {
+            from = win_offset;
+        }
+        if (win_offset > from || win_offset + win_len < data_end) {
+            if (win_offset == start) {
+                break;      // хост отдал меньше, чем просили, — оставляем как есть
+            }
+            return need(start);
+        }
+
+        const size_t len = static_cast<size_t>(data_end - from);
+        const uint64_t size = trailer_size(at(from), len);
+        if (size == 0 && from != start && len >= LYRICS3_END_SIZE &&
+            std::memcmp(at(data_end - LYRICS3_END_SIZE), "LYRICSEND", LYRICS3_END_SIZE) == 0) {
+            return need(start);     // начало Lyrics3 v1 ищется назад — нужно окно целиком
+        }
+        if (size == 0 || size > data_end - floor) {
+            break;
+        }
+        data_end -= size;
+        id3_bytes_skipped += size;
+    }
+
+    switch (mode_used) {
+        case MP3_MODE_EXACT_SCAN:
+            return start_scan();
+        case MP3_MODE_CBR_VERIFIED:
+            cbr_pos = audio_start + (data_end - audio_start) / 2;
+            phase = PHASE_CBR;
+            return STEP_CONTINUE;
+        case MP3_MODE_FAST_ESTIMATE:
+            // Выборка прочитала бы столько же, сколько весь файл
+            if (data_end - audio_end <= uint64_t(MP3_NATIVE_ESTIMATE_POINTS) * request_size) {
+                mode_used = MP3_MODE_EXACT_SCAN;
+                return start_scan();
+            }
+            est_pos = sample_point(0);
+            phase = PHASE_SAMPLE;
+            return STEP_CONTINUE;
+        default:
+            phase = PHASE_DONE;
+            return STEP_NEED_DATA;
+    }
+}
+
+/**
+ * Проверка CBR без VBR-заголовка: MP3_NATIVE_CBR_CHECK_FRAMES фреймов
+ * подряд с одним битрейтом в начале звука, затем (после тегов в конце)
+ * столько же с первого подтверждённого фрейма от середины данных.
+ * Читаются только окно в начале, хвост и окно в середине — сколько бы
+ * ни длился файл. Любое расхождение — откат к точному подсчёту.
+ */
+analyzer_t::step_t analyzer_t::step_cbr() {
+    if (cbr_stage == CBR_MID_SYNC) {
+        if (avail(cbr_pos) == 0) {
+            return (win_offset == cbr_pos) ? reject_cbr() : need(cbr_pos);
+        }
+
+        // Середина попадает в произвольное место фрейма
+        uint64_t offset = cbr_pos;
+        bool found = false;
+        for (; seek_sync(&offset); ++offset) {
+            frame_header_t hdr;
+            if (!parse_frame_header(at(offset), &hdr) || !same_stream(first, hdr)) {
+                continue;
+            }
+            bool need_more = false;
+            if (confirm_next(offset, hdr, &need_more)) {
+                found = true;
+                break;
+            }
+            if (need_more && offset > win_offset) {
+                return need(offset);
+            }
+        }
+        if (!found) {
+            return reject_cbr();
+        }
+        cbr_stage = CBR_MID_WALK;
+        cbr_pos = offset;
+        cbr_frames = 0;
+    }
+
+    while (cbr_frames < MP3_NATIVE_CBR_CHECK_FRAMES) {
+        if (avail(cbr_pos) < 4) {
+            // Данные кончились раньше — короткий файл дешевле посчитать точно
+            if (win_eof || win_offset == cbr_pos) {
+                return reject_cbr();
+            }
+            return need(cbr_pos);
+        }
+
+        frame_header_t hdr;
+        if (!parse_frame_header(at(cbr_pos), &hdr) || !same_stream(first, hdr)) {
+            return reject_cbr();
+        }
+        frames_inspected++;
+        if (cbr_stage == CBR_START && cbr_frames == 0) {
+            // Фрейм Info с испорченным тегом кодируется своим битрейтом:
+            // один такой фрейм пропускается и считается отдельно
+            if (!cbr_lead && hdr.bitrate != nominal_bitrate) {
+                cbr_lead = 1;
+                cbr_pos += hdr.frame_size;
+                continue;
+            }
+            cbr_bitrate = hdr.bitrate;
+            cbr_origin = cbr_pos;
+        }
+        if (hdr.bitrate != cbr_bitrate) {
+            return reject_cbr();
+        }
+        cbr_frames++;
+        cbr_pos += hdr.frame_size;
+    }
+
+    if (cbr_stage == CBR_START) {
+        // Середина считается от data_end — сначала теги в конце
+        cbr_stage = CBR_MID_SYNC;
+        phase = PHASE_TAIL;
+        return STEP_CONTINUE;
+    }
+    phase = PHASE_DONE;
+    return STEP_NEED_DATA;
+}
+
+analyzer_t::step_t analyzer_t::reject_cbr() {
+    mode_used = MP3_MODE_EXACT_SCAN;
+    if (cbr_stage == CBR_START) {
+        phase = PHASE_TAIL;     // теги в конце ещё не отрезаны
+        return STEP_CONTINUE;
+    }
+    return start_scan();
+}
+
+/// Начало участка index: середина index-й из MP3_NATIVE_ESTIMATE_POINTS равных частей данных
+uint64_t analyzer_t::sample_point(uint32_t index) const {
+    const uint64_t span = data_end - audio_end;
+    return audio_end + span * (2u * index + 1) / (2u * MP3_NATIVE_ESTIMATE_POINTS);
+}
+
+/**
+ * Оценка VBR без Xing: стратифицированная выборка. На каждом участке —
+ * одно окно: первый подтверждённый фрейм потока и все фреймы, чьи
+ * заголовки лежат в окне; по ним средний размер фрейма участка.
+ * Длительность — размер данных / среднее по участкам; разброс средних
+ * даёт доверительный интервал (estimate()). Чтений — MP3_NATIVE_ESTIMATE_POINTS
+ * плюс начало и хвост, независимо от размера файла.
+ */
+analyzer_t::step_t analyzer_t::step_sample() {
+    while (est_point < MP3_NATIVE_ESTIMATE_POINTS) {
+        // Окно должно идти от est_pos на полный запрос (или до конца данных)
+        const uint64_t left = data_end - est_pos;
+        const size_t want = left < request_size ? static_cast<size_t>(left) : request_size;
+        if (avail(est_pos) < want && win_offset != est_pos) {
+            return need(est_pos);
+        }
+
+        uint64_t offset = est_pos;
+        bool found = false;
+        frame_header_t hdr;
+        for (; seek_sync(&offset); ++offset) {
+            if (!parse_frame_header(at(offset), &hdr) || !same_stream(first, hdr)) {
+                continue;
+            }
+            bool need_more = false;
+            if (confirm_next(offset, hdr, &need_more)) {
+                found = true;
+                break;
+            }
+            if (need_more && offset > win_offset) {
+                est_pos = offset;
+                return need(offset);
+            }
+        }
+
+        uint64_t frames_here = 0;
+        uint64_t bytes_here = 0;
+        while (found && avail(offset) >= 4 && parse_frame_header(at(offset), &hdr) &&
+               same_stream(first, hdr)) {
+            frames_here++;
+            bytes_here += hdr.frame_size;
+            offset += hdr.frame_size;
+        }
+
+        if (frames_here) {
+            const uint64_t mean_q8 = bytes_here * 256u / frames_here;
+            est_sum += mean_q8;
+            est_sum_sq += mean_q8 * mean_q8;
+            est_frames += frames_here;
+            est_bytes += bytes_here;
+            frames_inspected += frames_here;
+            est_used++;
+        }
+        if (++est_point < MP3_NATIVE_ESTIMATE_POINTS) {
+            est_pos = sample_point(est_point);
+        }
+    }
+
+    // Без разброса интервала не построить — считаем точно
+    if (est_used < 2) {
+        mode_used = MP3_MODE_EXACT_SCAN;
+        return start_scan();
+    }
+    phase = PHASE_DONE;
+    return STEP_NEED_DATA;
+}
+
+analyzer_t::step_t analyzer_t::start_scan() {
+    pos = audio_end;    // step_vbr оставил здесь начало звука
+    phase = PHASE_SCAN;
+    // Делить ли подсчёт на участки, сессия решает до первого окна
+    if (scan_split) {
+        return need(pos);
+    }
+    return avail(pos) ? STEP_CONTINUE : need(pos);
+}
+
+uint8_t analyzer_t::stats_phase() const {
+    switch (phase) {
+        case PHASE_TAIL:   return PHASE_ID3V2;  // теги в конце — та же работа, что ID3v2 в начале
+        case PHASE_CBR:    return PHASE_VBR;
+        case PHASE_SAMPLE: return PHASE_SCAN;
+        default:           return phase;
+    }
+}
+
+mp3_result_t analyzer_t::finish(mp3_audio_info_t* out) const {
+    std::memset(out, 0, sizeof(*out));
+
+    if (phase == PHASE_FAILED) {
+        return error;
+    }
+    if (phase != PHASE_DONE) {
+        return MP3_ERR_INTERNAL;
+    }
+
+    out->mode = mode_used;
+    if (mode_used == MP3_MODE_CBR_VERIFIED) {
+        // Фреймы с padding чередуются, поэтому число фреймов — ближайшее целое
+        const uint64_t frame_bits = static_cast<uint64_t>(first.samples) * cbr_bitrate;
+        const uint64_t frame_count =
+            cbr_lead + ((data_end - cbr_origin) * 8u * first.sample_rate + frame_bits / 2) / frame_bits;
+        out->sample_rate = first.sample_rate;
+        out->channels = first.channels;
+        out->bits_per_sample = 16;
+        out->bitrate = cbr_bitrate;
+        out->duration_ms = static_cast<uint32_t>(
+            frame_count * first.samples * 1000u / first.sample_rate);
+        out->data_size = data_end - audio_start;
+        out->valid = 1;
+        return MP3_OK;
+    }
+    if (mode_used == MP3_MODE_FAST_ESTIMATE) {
+        // Средний размер фрейма по участкам (Q8) -> число фреймов в данных
+        const uint64_t mean_q8 = est_sum / est_used;
+        const uint64_t frame_count = ((data_end - audio_end) * 256u + mean_q8 / 2) / mean_q8;
+        out->sample_rate = first.sample_rate;
+        out->channels = first.channels;
+        out->bits_per_sample = 16;
+        out->bitrate = static_cast<uint32_t>(
+            mean_q8 * 8u * first.sample_rate / (256u * first.samples));
+        out->duration_ms = static_cast<uint32_t>(
+            frame_count * first.samples * 1000u / first.sample_rate);
+        out->data_size = data_end - audio_start;
+        out->valid = 1;
+        return MP3_OK;
+    }
+
+    uint64_t total_samples;
+    uint64_t data_size;
+    uint32_t constant_bitrate = 0;
+
+    if (mode_used == MP3_MODE_TRUST_XING) {
+        total_samples = static_cast<uint64_t>(vbr.frames) * first.samples;
+        if (vbr.bytes) {
+            data_size = vbr.bytes;
+        } else if (data_end > audio_start) {
+            data_size = data_end - audio_start;
+        } else {
+            data_size = 0;
+        }
+        if (vbr.kind == VBR_INFO) {
+            constant_bitrate = nominal_bitrate;
+        }
+    } else {
+        if (frames == 0) {
+            return MP3_ERR_INVALID_FORMAT;
+        }
+        total_samples = samples;
+        data_size = audio_end - audio_start;
+        if (!variable_bitrate) {
+            constant_bitrate = nominal_bitrate;
+        }
+    }
+
+    out->sample_rate = first.sample_rate;
+    out->channels = first.channels;
+    out->bits_per_sample = 16;
+    out->duration_ms =
+        static_cast<uint32_t>(total_samples * 1000u / first.sample_rate);
+    out->data_size = data_size;
+
+    if (constant_bitrate) {
+        out->bitrate = constant_bitrate;
+    } else if (data_size == 0 || total_samples == 0) {
+        out->bitrate = first.bitrate;
+    } else {
+        out->bitrate = static_cast<uint32_t>(
+            data_size * 8u * first.sample_rate / total_samples);
+    }
+
+    out->valid = 1;
+    return MP3_OK;
+}
+
+mp3_result_t analyzer_t::progress(mp3_audio_info_t* out) const {
+    if (phase == PHASE_FAILED && (error == MP3_ERR_CANCELLED || error == MP3_ERR_TIMEOUT)) {
+        // Разобранное до остановки не потеряно: оценка, как если бы анализ шёл дальше
+        analyzer_t stopped = *this;
+        stopped.phase = failed_phase;
+        if (stopped.progress(out) != MP3_OK) {
+            std::memset(out, 0, sizeof(*out));
+        }
+        return error;
+    }
+    if (phase == PHASE_DONE || phase == PHASE_FAILED) {
+        return finish(out);
+    }
+
+    std::memset(out, 0, sizeof(*out));
+    if (phase == PHASE_ID3V2 || phase == PHASE_SYNC) {
+        return MP3_ERR_PENDING;
+    }
+
+    const bool counting = (phase == PHASE_SCAN && frames > 0);
+    if (!counting && vbr.frames == 0) {
+        // Первый фрейм найден, подсчёта ещё нет: размер данных по битрейту заголовка
+        if (data_end <= audio_start) {
+            return MP3_ERR_PENDING;
+        }
+        const uint32_t bitrate = nominal_bitrate ? nominal_bitrate : first.bitrate;
+        out->sample_rate = first.sample_rate;
+        out->channels = first.channels;
+        out->bits_per_sample = 16;
+        out->bitrate = bitrate;
+        out->data_size = data_end - audio_start;
+        out->duration_ms = static_cast<uint32_t>(out->data_size * 8000u / bitrate);
+        out->mode = MP3_MODE_FAST_ESTIMATE;
+        out->valid = 1;
+        return MP3_OK;
+    }
+
+    // Подсчёт, остановленный здесь, дал бы ровно этот итог; до подсчёта —
+    // число фреймов из Xing, даже если режим его не принимает как итог
+    analyzer_t snapshot = *this;
+    snapshot.phase = PHASE_DONE;
+    if (!counting) {
+        snapshot.mode_used = MP3_MODE_TRUST_XING;
+    }
+    const mp3_result_t result = snapshot.finish(out);
+    if (result != MP3_OK) {
+        return result;
+    }
+    if (counting && data_end > pos && audio_end > scan_first) {
+        // Остаток данных — по среднему размеру посчитанного фрейма
+        const uint64_t rest = (data_end - pos) * frames / (audio_end - scan_first);
+        out->duration_ms = static_cast<uint32_t>(
+            (samples + rest * first.samples) * 1000u / first.sample_rate);
+        out->data_size = data_end - audio_start;
+        out->mode = MP3_MODE_FAST_ESTIMATE;
+    } else if (!counting && mode_used != MP3_MODE_TRUST_XING) {
+        out->mode = MP3_MODE_FAST_ESTIMATE;
+    }
+    return MP3_OK;
+}
+
+mp3_result_t analyzer_t::estimate(mp3_duration_estimate_t* out) const {
+    std::memset(out, 0, sizeof(*out));
+
+    mp3_audio_info_t info;
+    const mp3_result_t result = finish(&info);
+    if (result != MP3_OK) {
+        return result;
+    }
+
+    uint64_t error_ms = 0;
+    if (mode_used == MP3_MODE_FAST_ESTIMATE) {
+        // Стандартная ошибка среднего: s / sqrt(n), s² — несмещённая дисперсия
+        const uint64_t n = est_used;
+        const uint64_t mean_q8 = est_sum / n;
+        const uint64_t spread_q16 = est_sum_sq - est_sum * est_sum / n;
+        const uint64_t stderr_q8 = isqrt(spread_q16 / (n - 1) / n);
+        uint64_t rel_q20 = (student_t975_x1000(n - 1) * stderr_q8 << 20) / (mean_q8 * 1000u);
+        // Байт padding на участок: у CBR все участки могут дать одно и то же
+        // смещённое среднее, и разброс этого не покажет
+        rel_q20 += (n << 20) / est_bytes;
+        // Плюс фрейм на границе данных (испорченный Info, обрезанный конец)
+        error_ms = ((info.duration_ms * rel_q20 + (uint64_t(1) << 19)) >> 20) +
+                   (uint64_t(first.samples) * 1000u + first.sample_rate - 1) / first.sample_rate;
+        out->sample_points = est_used;
+        out->sampled_frames = static_cast<uint32_t>(est_frames);
+    } else if (mode_used == MP3_MODE_CBR_VERIFIED) {
+        error_ms = (uint64_t(first.samples) * 1000u + first.sample_rate - 1) / first.sample_rate;
+    }
+
+    out->duration_ms = info.duration_ms;
+    out->error_ms = static_cast<uint32_t>(error_ms);
+    out->low_ms = info.duration_ms > error_ms ? static_cast<uint32_t>(info.duration_ms - error_ms) : 0;
+    out->high_ms = static_cast<uint32_t>(info.duration_ms + error_ms);
+    return MP3_OK;
+}
+
+// ============================================================================
+// Сессия
+// ============================================================================
+
+namespace {
+
+/// Сколько читать по запросу: не больше scratch и остатка источника
+size_t request_len(const mp3_host_api_t& host, const request_t& req) {
+    size_t requested = req.size < MP3_NATIVE_SCRATCH_SIZE ? req.size : MP3_NATIVE_SCRATCH_SIZE;
+    if (host.source_size) {
+        const uint64_t left =
+            (req.offset < host.source_size) ? host.source_size - req.offset : 0;
+        if (requested > left) {
+            requested = static_cast<size_t>(left);
+        }
+    }
+    return requested;
+}
+
+/// Прочитать запрос анализатора: borrow_at, при отказе — read_at в scratch
+mp3_result_t read_request(
+    const mp3_host_api_t& host,
+    const request_t& req,
+    uint8_t* scratch,
+    const uint8_t** out_data,
+    size_t* out_len
+) {
+    const size_t requested = request_len(host, req);
+
+    *out_data = scratch;
+    *out_len = 0;
+    if (requested == 0) {
+        return MP3_OK;
+    }
+
+    // Сначала без копирования; хост может отказать — тогда read_at
+    mp3_result_t result = MP3_ERR_NOT_IMPLEMENTED;
+    if (host.borrow_at) {
+        result = host.borrow_at(host.user_ctx, req.offset, requested, out_data, out_len);
+    }
+    if (result == MP3_ERR_NOT_IMPLEMENTED) {
+        *out_data = scratch;
+        result = host.read_at(host.user_ctx, req.offset, scratch, requested, out_len);
+    }
+    if (result == MP3_OK && *out_len > requested) {
+        *out_len = requested;
+    }
+    return result;
+}
+
+/// Прогнать анализатор до конца (участок подсчёта: время считает вызывающий)
+void drive(analyzer_t* analyzer, const mp3_host_api_t& host, uint8_t* scratch) {
+    request_t req;
+    while (analyzer->pending(&req)) {
+        const uint8_t* data = nullptr;
+        size_t got = 0;
+        const mp3_result_t result = read_request(host, req, scratch, &data, &got);
+        if (result != MP3_OK) {
+            analyzer->fail(result);
+            return;
+        }
+        analyzer->feed(data, got);
+    }
+}
+
+/**
+ * Участок подсчёта с offset: копия родителя после тегов и VBR, счётчики
+ * с нуля. resync — offset в произвольном месте данных, первый фрейм
+ * ищется с подтверждением, как после рассинхронизации.
+ */
+void chunk_start(analyzer_t* chunk, const analyzer_t& parent,
+                 uint64_t offset, uint64_t stop, bool resync) {
+    *chunk = parent;
+    chunk->phase = analyzer_t::PHASE_SCAN;
+    chunk->pos = offset;
+    chunk->frames = 0;
+    chunk->samples = 0;
+    chunk->audio_end = offset;
+    chunk->nominal_bitrate = 0;
+    chunk->variable_bitrate = 0;
+    chunk->resyncing = resync ? 1 : 0;
+    chunk->scan_split = 0;
+    chunk->scan_stop = stop;
+    chunk->scan_first = 0;
+    chunk->frames_inspected = 0;
+}
+
+/// Где участок передал подсчёт следующему; UINT64_MAX — дошёл до конца данных
+uint64_t chunk_end(const analyzer_t& chunk) {
+    if (chunk.scan_stop && !chunk.resyncing && chunk.pos >= chunk.scan_stop) {
+        return chunk.pos;
+    }
+    return UINT64_MAX;
+}
+
+struct parallel_scan_t {
+    const mp3_host_api_t* host;
+    analyzer_t chunks[MP3_NATIVE_PARALLEL_CHUNKS];
+};
+
+void scan_chunk(void* task_ctx, uint32_t index) {
+    auto* job = static_cast<parallel_scan_t*>(task_ctx);
+    uint8_t scratch[MP3_NATIVE_SCRATCH_SIZE];
+    drive(&job->chunks[index], *job->host, scratch);
+}
+
+/**
+ * Точный подсчёт участками на потоках хоста.
+ *
+ * Участок i > 0 начинается с первого подтверждённого фрейма от своей
+ * границы, а заканчивается на первом фрейме от границы следующего.
+ * Подсчёт детерминирован по данным, поэтому если участок начался там,
+ * где закончился предыдущий, его фреймы — ровно те, что насчитал бы
+ * последовательный проход. Иначе (ложный sync у границы) участок
+ * пересчитывается на вызывающем потоке от конца предыдущего.
+ */
+void parallel_scan(session_t* session) {
+    analyzer_t& analyzer = session->analyzer;
+    const mp3_host_api_t& host = session->host;
+
+    parallel_scan_t job;
+    job.host = &host;
+
+    const uint32_t count = MP3_NATIVE_PARALLEL_CHUNKS;
+    const uint64_t begin = analyzer.pos;
+    const uint64_t span = analyzer.data_end - begin;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint64_t offset = begin + span * i / count;
+        const uint64_t stop = (i + 1 < count) ? begin + span * (i + 1) / count : 0;
+        chunk_start(&job.chunks[i], analyzer, offset, stop, i > 0);
+    }
+
+    host.parallel_for(host.parallel_ctx, count, scan_chunk, &job);
+
+    uint64_t end = begin;
+    for (uint32_t i = 0; i < count && end != UINT64_MAX; ++i) {
+        analyzer_t& chunk = job.chunks[i];
+        analyzer.frames_inspected += chunk.frames_inspected;
+
+        const bool stitched = (i == 0) || (chunk.frames && chunk.scan_first == end);
+        if (!stitched && chunk.phase != analyzer_t::PHASE_FAILED) {
+            chunk_start(&chunk, analyzer, end, chunk.scan_stop, false);
+            drive(&chunk, host, session->scratch);
+            analyzer.frames_inspected += chunk.frames_inspected;
+        }
+        if (chunk.phase == analyzer_t::PHASE_FAILED) {
+            analyzer.fail(chunk.error);
+            return;
+        }
+
+        if (chunk.frames) {
+            if (analyzer.frames == 0) {
+                analyzer.nominal_bitrate = chunk.nominal_bitrate;
+            } else if (chunk.nominal_bitrate != analyzer.nominal_bitrate) {
+                analyzer.variable_bitrate = 1;
+            }
+            analyzer.variable_bitrate |= chunk.variable_bitrate;
+            analyzer.frames += chunk.frames;
+            analyzer.samples += chunk.samples;
+            analyzer.audio_end = chunk.audio_end;
+        }
+        end = chunk_end(chunk);
+    }
+
+    analyzer.pos = analyzer.audio_end;
+    analyzer.phase = analyzer_t::PHASE_DONE;
+}
+
+/// Оценка для progress: первая — как только есть, дальше — через MP3_NATIVE_PROGRESS_BYTES
+void session_report(session_t* session, size_t fed) {
+    session->progress_bytes += fed;
+    if (!session->progress || session->progress_bytes < session->progress_next) {
+        return;
+    }
+
+    // Итог уходит из session_finish
+    const analyzer_t& analyzer = session->analyzer;
+    if (analyzer.phase == analyzer_t::PHASE_DONE || analyzer.phase == analyzer_t::PHASE_FAILED) {
+        return;
+    }
+
+    mp3_audio_info_t info;
+    if (analyzer.progress(&info) != MP3_OK) {
+        return;
+    }
+    session->progress(session->progress_ctx, &info, MP3_PROGRESS_ESTIMATE);
+    session->progress_next = session->progress_bytes + MP3_NATIVE_PROGRESS_BYTES;
+}
+
+} // namespace
+
+void session_begin(session_t* session, const mp3_analyze_options_t* options) {
+    session->analyzer.reset(session->host.source_size, options->mode);
+    std::memset(session->phase_us, 0, sizeof(session->phase_us));
+    std::memset(&session->request, 0, sizeof(session->request));
+    session->step_phase = MP3_PHASE_COUNT;
+    session->step_started = 0;
+    session->progress = options->progress;
+    session->progress_ctx = options->progress_ctx;
+    session->progress_bytes = 0;
+    session->progress_next = 0;
+}
+
+bool session_pending(session_t* session, request_t* out_req) {
+    analyzer_t& analyzer = session->analyzer;
+    const mp3_host_api_t& host = session->host;
+
+    request_t req;
+    while (analyzer.pending(&req)) {
+        req.size = request_len(host, req);
+        if (req.size == 0) {
+            // За концом источника читать нечего — пустое окно и есть ответ
+            analyzer.feed(session->scratch, 0);
+            continue;
+        }
+        session->request = req;
+        session->step_phase = analyzer.stats_phase();
+        session->step_started = host.clock_us ? host.clock_us(host.user_ctx) : 0;
+        *out_req = req;
+        return true;
+    }
+    return false;
+}
+
+void session_feed(session_t* session, mp3_result_t read_result, size_t len) {
+    analyzer_t& analyzer = session->analyzer;
+    const mp3_host_api_t& host = session->host;
+
+    if (read_result != MP3_OK) {
+        analyzer.fail(read_result);
+    } else {
+        const size_t fed = len < session->request.size ? len : session->request.size;
+        analyzer.feed(session->scratch, fed);
+        session_report(session, fed);
+    }
+
+    if (host.clock_us && session->step_phase < MP3_PHASE_COUNT) {
+        session->phase_us[session->step_phase] +=
+            host.clock_us(host.user_ctx) - session->step_started;
+    }
+    session->step_phase = MP3_PHASE_COUNT;
+}
+
+mp3_result_t session_finish(session_t* session, mp3_audio_info_t* out_info) {
+    const mp3_result_t result = session->analyzer.finish(out_info);
+    if (result == MP3_OK && session->progress) {
+        session->progress(session->progress_ctx, out_info, MP3_PROGRESS_FINAL);
+    }
+    return result;
+}
+
+mp3_result_t session_progress(const session_t* session, mp3_audio_info_t* out_info) {
+    return session->analyzer.progress(out_info);
+}
+
+bool session_step(session_t* session, uint32_t budget_bytes) {
+    analyzer_t& analyzer = session->analyzer;
+    const mp3_host_api_t& host = session->host;
+
+    uint64_t consumed = 0;
+    request_t req;
+    while (analyzer.pending(&req)) {
+        if (consumed && consumed >= budget_bytes) {
+            return false;
+        }
+
+        const uint8_t phase = analyzer.stats_phase();
+        const uint64_t started = host.clock_us ? host.clock_us(host.user_ctx) : 0;
+
+        if (analyzer.scan_split && analyzer.phase == analyzer_t::PHASE_SCAN) {
+            // Подсчёт ещё не начат; мелкие файлы потокам не отдаём
+            analyzer.scan_split = 0;
+            if (analyzer.data_end > analyzer.pos &&
+                analyzer.data_end - analyzer.pos >= MP3_NATIVE_PARALLEL_MIN_BYTES) {
+                parallel_scan(session);
+                if (host.clock_us) {
+                    session->phase_us[MP3_PHASE_SCAN] += host.clock_us(host.user_ctx) - started;
+                }
+                continue;
+            }
+        }
+
+        const uint8_t* data = nullptr;
+        size_t got = 0;
+        const mp3_result_t read_result = read_request(host, req, session->scratch, &data, &got);
+        if (read_result != MP3_OK) {
+            analyzer.fail(read_result);
+            break;
+        }
+
+        analyzer.feed(data, got);
+        consumed += got;
+        session_report(session, got);
+
+        if (host.clock_us && phase < MP3_PHASE_COUNT) {
+            session->phase_us[phase] += host.clock_us(host.user_ctx) - started;
+        }
+    }
+    return true;
+}
+
+mp3_result_t session_run(
+    session_t* session,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+) {
+    session_begin(session, options);
+    session->analyzer.scan_split = session->host.parallel_for ? 1 : 0;
+    while (!session_step(session, UINT32_MAX)) {
+    }
+    return session_finish(session, out_info);
+}
+
+void session_stats(const session_t* session, mp3_session_stats_t* out_stats) {
+    out_stats->frames_inspected = session->analyzer.frames_inspected;
+    out_stats->id3_bytes_skipped = session->analyzer.id3_bytes_skipped;
+    std::memcpy(out_stats->phase_us, session->phase_us, sizeof(out_stats->phase_us));
+}
+
+mp3_result_t session_estimate(const session_t* session, mp3_duration_estimate_t* out) {
+    return session->analyzer.estimate(out);
+}
+
+mp3_result_t analyze_buffer(const uint8_t* data, size_t len, mp3_audio_info_t* out_info) {
+    analyzer_t analyzer;
+    analyzer.reset(len);
+
+    // Окно — весь остаток буфера: размер запроса не важен, данные уже в памяти
+    request_t req;
+    while (analyzer.pending(&req)) {
+        if (req.offset >= len) {
+            analyzer.feed(nullptr, 0);
+        } else {
+            const size_t offset = static_cast<size_t>(req.offset);
+            analyzer.feed(data + offset, len - offset);
+        }
+    }
+
+    return analyzer.finish(out_info);
+}
+
+} // namespace mp3_native
@@ -0,0 +1,413 @@
+/**
+ * @file mp3_native.h
+ * @brief Нативный C++ движок разбора MPEG-фреймов (внутренний заголовок)
+ *
+ * Используется weak-реализациями mp3_rust_session_*_impl в mp3_lib.cpp,
+ * когда Rust blob не слинкован.
+ *
+ * Движок построен как машина состояний без собственного ввода-вывода:
+ *  - analyzer_t сообщает, какой диапазон источника ему нужен (pending);
+ *  - вызывающий код читает этот диапазон любым способом и отдаёт (feed);
+ *  - по завершении finish() заполняет mp3_audio_info_t.
+ * Движок не выделяет память: всё состояние лежит внутри analyzer_t,
+ * а буферы предоставляет вызывающий.
+ */
+
+#pragma once
+
+#include "mp3_lib.h"
+
+namespace mp3_native {
+
+// ============================================================================
+// Конфигурация
+// ============================================================================
+
+#ifndef MP3_NATIVE_SCRATCH_SIZE
+/// Размер окна чтения сессии; должен вмещать самый длинный фрейм + заголовок
+#define MP3_NATIVE_SCRATCH_SIZE 4096
+#endif
+
+#ifndef MP3_NATIVE_CBR_CHECK_FRAMES
+/// Сколько фреймов подряд с одним битрейтом подтверждают CBR (в начале и в середине)
+#define MP3_NATIVE_CBR_CHECK_FRAMES 8u
+#endif
+
+#ifndef MP3_NATIVE_ESTIMATE_POINTS
+/// Сколько участков данных читает оценка VBR без Xing (по одному окну на участок)
+#define MP3_NATIVE_ESTIMATE_POINTS 8u
+#endif
+
+static_assert(MP3_NATIVE_ESTIMATE_POINTS >= 2,
+              "MP3_NATIVE_ESTIMATE_POINTS must allow a variance estimate");
+
+#ifndef MP3_NATIVE_PARALLEL_CHUNKS
+/// На сколько участков делится точный подсчёт, если у хоста есть parallel_for
+#define MP3_NATIVE_PARALLEL_CHUNKS 16u
+#endif
+
+#ifndef MP3_NATIVE_PARALLEL_MIN_BYTES
+/// Меньше этого объёма данных подсчёт идёт последовательно
+#define MP3_NATIVE_PARALLEL_MIN_BYTES (4u * 1024u * 1024u)
+#endif
+
+static_assert(MP3_NATIVE_PARALLEL_CHUNKS >= 2,
+              "MP3_NATIVE_PARALLEL_CHUNKS must split the scan");
+
+#ifndef MP3_NATIVE_PROGRESS_BYTES
+/// Не чаще чем через столько разобранных байт уточняется оценка (mp3_progress_fn)
+#define MP3_NATIVE_PROGRESS_BYTES (256u * 1024u)
+#endif
+
+#ifndef MP3_NATIVE_MAX_SYNC_SEARCH
+/// Сколько байт после тегов просматривается в поисках первого фрейма
+#define MP3_NATIVE_MAX_SYNC_SEARCH (1024u * 1024u)
+#endif
+
+/// Максимальный размер MPEG-фрейма (MPEG-2 Layer II, 160 kbps, 8 kHz, padding)
+constexpr size_t MAX_FRAME_SIZE = 2881;
+
+static_assert(MP3_NATIVE_SCRATCH_SIZE >= MAX_FRAME_SIZE + 4,
+              "MP3_NATIVE_SCRATCH_SIZE must fit the largest MPEG frame");
+
+// ============================================================================
+// Заголовок фрейма
+// ============================================================================
+
+enum mpeg_version_t : uint8_t {
+    MPEG_1  = 0,
+    MPEG_2  = 1,
+    MPEG_25 = 2,
+};
+
+struct frame_header_t {
+    uint8_t version;        ///< mpeg_version_t
+    uint8_t layer;          ///< 1..3
+    uint8_t channels;       ///< 1 или 2
+    uint8_t padding;        ///< Бит padding
+    uint32_t bitrate;       ///< bps
+    uint32_t sample_rate;   ///< Hz
+    uint32_t frame_size;    ///< Полный размер фрейма с заголовком (байт)
+    uint32_t samples;       ///< Сэмплов на фрейм (на канал)
+};
+
+/**
+ * @brief Разобрать 4-байтный заголовок MPEG-фрейма
+ * @return true, если заголовок валиден (free-format не поддерживается)
+ */
+bool parse_frame_header(const uint8_t* p, frame_header_t* out);
+
+/**
+ * @brief Совместимы ли два заголовка одного потока (версия, слой, частота)
+ */
+bool same_stream(const frame_header_t& a, const frame_header_t& b);
+
+// ============================================================================
+// Поиск sync-слова (mp3_sync_scan.cpp)
+// ============================================================================
+
+/// Реализация поиска sync-слова
+enum sync_impl_t : uint8_t {
+    SYNC_SCALAR = 0,
+    SYNC_SSE2   = 1,
+    SYNC_AVX2   = 2,
+    SYNC_NEON   = 3,
+    SYNC_IMPL_COUNT,
+};
+
+/**
+ * @brief Первый кандидат sync-слова в p[0..len)
+ *
+ * Кандидат — позиция i, где p[i] == 0xFF и (p[i + 1] & 0xE0) == 0xE0;
+ * читаются только байты p[0..len). Реализация (SIMD или scalar)
+ * выбирается один раз, при первом вызове.
+ *
+ * @return Смещение кандидата или len, если его нет
+ */
+size_t find_sync(const uint8_t* p, size_t len);
+
+/// Эталонная побайтовая реализация find_sync
+size_t find_sync_scalar(const uint8_t* p, size_t len);
+
+/// find_sync конкретной реализацией (недоступная — scalar); для тестов и бенчмарка
+size_t find_sync_with(uint8_t impl, const uint8_t* p, size_t len);
+
+/// Реализация, которую использует find_sync
+uint8_t sync_impl();
+
+/// Собрана ли реализация и поддерживает ли её процессор
+bool sync_impl_available(uint8_t impl);
+
+const char* sync_impl_name(uint8_t impl);
+
+// ============================================================================
+// Xing / Info / VBRI
+// ============================================================================
+
+enum vbr_kind_t : uint8_t {
+    VBR_NONE = 0,
+    VBR_XING = 1,   ///< "Xing" — VBR
+    VBR_INFO = 2,   ///< "Info" — CBR с LAME-тегом
+    VBR_VBRI = 3,   ///< Fraunhofer VBRI
+};
+
+struct vbr_header_t {
+    uint8_t kind;       ///< vbr_kind_t
+    uint32_t frames;    ///< Число аудиофреймов (без самого фрейма заголовка), 0 если нет
+    uint32_t bytes;     ///< Размер потока в байтах, 0 если нет
+};
+
+/**
+ * @brief Найти Xing/Info/VBRI-заголовок внутри первого фрейма
+ *
+ * @param frame Начало фрейма (с 4-байтным заголовком)
+ * @param len Сколько байт фрейма доступно
+ */
+bool parse_vbr_header(
+    const uint8_t* frame,
+    size_t len,
+    const frame_header_t& hdr,
+    vbr_header_t* out
+);
+
+/**
+ * @brief Сколько байт от начала фрейма нужно для parse_vbr_header()
+ */
+size_t vbr_probe_size(const frame_header_t& hdr);
+
+// ============================================================================
+// Анализатор
+// ============================================================================
+
+/// Диапазон, который анализатор просит прочитать
+struct request_t {
+    uint64_t offset;
+    size_t size;        ///< Желаемый размер; короткий ответ означает конец источника
+};
+
+struct analyzer_t {
+    enum phase_t : uint8_t {
+        PHASE_ID3V2,
+        PHASE_SYNC,
+        PHASE_VBR,
+        PHASE_SCAN,
+        PHASE_TAIL,         ///< Теги в конце источника (время — в MP3_PHASE_ID3)
+        PHASE_CBR,          ///< Проверка CBR без VBR-заголовка (время — в MP3_PHASE_VBR)
+        PHASE_SAMPLE,       ///< Выборка участков для оценки VBR (время — в MP3_PHASE_SCAN)
+        PHASE_DONE,
+        PHASE_FAILED,
+    };
+
+    /// Подготовить анализатор к новому источнику
+    void reset(uint64_t source_size, uint8_t mode = MP3_MODE_TRUST_XING);
+
+    /// Нужны ли ещё данные; если да — какой диапазон
+    bool pending(request_t* req) const;
+
+    /// Передать данные, прочитанные по последнему запросу pending()
+    void feed(const uint8_t* data, size_t len);
+
+    /// Прервать анализ с ошибкой (например, ошибка чтения хоста)
+    void fail(mp3_result_t code);
+
+    /// Итог анализа
+    mp3_result_t finish(mp3_audio_info_t* out) const;
+
+    /**
+     * Лучшая длительность по уже разобранным данным: после конца анализа —
+     * итог; во время подсчёта — насчитанные фреймы плюс (если известен
+     * размер) остаток данных по их среднему размеру; до подсчёта — размер
+     * данных по битрейту первого фрейма. MP3_ERR_PENDING — оценить не
+     * по чему (первый фрейм не найден или размер неизвестен). Анализ,
+     * прерванный MP3_ERR_CANCELLED / MP3_ERR_TIMEOUT, возвращает этот
+     * код, а в out — оценку на момент остановки (valid = 0, если её нет).
+     */
+    mp3_result_t progress(mp3_audio_info_t* out) const;
+
+    /// Фаза для mp3_session_stats_t::phase_us (mp3_phase_t)
+    uint8_t stats_phase() const;
+
+    /// Точность длительности: 95% интервал для оценки по выборке
+    mp3_result_t estimate(mp3_duration_estimate_t* out) const;
+
+    // --- Состояние (POD, без аллокаций) ---
+    uint8_t phase;
+    uint8_t failed_phase;       ///< Фаза, на которой анализ прерван (fail)
+    uint8_t mode;               ///< Запрошенный mp3_analyze_mode_t
+    uint8_t mode_used;          ///< Как получен результат
+    mp3_result_t error;
+    uint64_t source_size;       ///< 0 — неизвестен
+    uint64_t data_end;          ///< Конец аудиоданных: source_size без тегов в конце
+    uint64_t pos;               ///< Смещение следующего запроса
+    size_t request_size;
+
+    uint64_t sync_origin;       ///< Откуда начат поиск первого фрейма
+    uint64_t audio_start;       ///< Смещение первого фрейма
+    frame_header_t first;
+    vbr_header_t vbr;
+    uint32_t nominal_bitrate;   ///< Битрейт потока: фрейм после Info / первый звуковой фрейм
+
+    uint64_t frames;            ///< Аудиофреймов насчитано сканированием
+    uint64_t samples;
+    uint64_t audio_end;         ///< Конец последнего найденного фрейма
+    uint8_t variable_bitrate;   ///< Встретились фреймы с разным битрейтом
+    uint8_t resyncing;          ///< Подсчёт ищет следующий подтверждённый фрейм
+
+    // Участок параллельного подсчёта
+    uint8_t scan_split;         ///< start_scan останавливается до первого окна подсчёта
+    uint64_t scan_stop;         ///< Первый фрейм с этого смещения — уже следующего участка (0 — нет)
+    uint64_t scan_first;        ///< Смещение первого посчитанного фрейма
+
+    // Проверка CBR: по MP3_NATIVE_CBR_CHECK_FRAMES фреймов в начале и в середине
+    uint8_t cbr_stage;          ///< cbr_stage_t
+    uint32_t cbr_bitrate;       ///< Битрейт первого проверенного фрейма
+    uint32_t cbr_frames;        ///< Фреймов подтверждено на текущем участке
+    uint64_t cbr_pos;           ///< Следующий фрейм (или начало поиска в середине)
+    uint64_t cbr_origin;        ///< Первый фрейм с cbr_bitrate
+    uint8_t cbr_lead;           ///< Перед ним один фрейм с другим битрейтом (испорченный Info)
+
+    // Оценка VBR по выборке: средний размер фрейма на MP3_NATIVE_ESTIMATE_POINTS участках
+    uint32_t est_point;         ///< Текущий участок
+    uint32_t est_used;          ///< Участков, где нашлись фреймы
+    uint64_t est_pos;           ///< Откуда искать фрейм на текущем участке
+    uint64_t est_frames;        ///< Фреймов в выборке
+    uint64_t est_bytes;         ///< Их суммарный размер
+    uint64_t est_sum;           ///< Σ среднего размера фрейма участка (Q8)
+    uint64_t est_sum_sq;        ///< Σ его квадратов (Q16)
+
+    // Статистика разбора
+    uint64_t frames_inspected;  ///< Разобранных заголовков фреймов
+    uint64_t id3_bytes_skipped; ///< ID3v2 в начале + теги в конце
+
+    // Текущее окно (валидно только внутри feed)
+    const uint8_t* win;
+    uint64_t win_offset;
+    size_t win_len;
+    uint8_t win_eof;
+
+private:
+    enum step_t : uint8_t { STEP_CONTINUE, STEP_NEED_DATA };
+    enum cbr_stage_t : uint8_t { CBR_START, CBR_MID_SYNC, CBR_MID_WALK };
+
+    size_t avail(uint64_t offset) const;
+    const uint8_t* at(uint64_t offset) const;
+    bool seek_sync(uint64_t* offset) const;
+    step_t need(uint64_t offset);
+    bool confirm_next(uint64_t offset, const frame_header_t& hdr, bool* need_more) const;
+
+    step_t step_id3v2();
+    step_t step_sync();
+    step_t step_vbr();
+    step_t step_scan();
+    step_t step_tail();
+    step_t step_cbr();
+    step_t reject_cbr();
+    step_t step_sample();
+    uint64_t sample_point(uint32_t index) const;
+    step_t start_scan();
+};
+
+// ============================================================================
+// Сессия поверх mp3_host_api_t
+// ============================================================================
+
+static_assert(int(analyzer_t::PHASE_ID3V2) == int(MP3_PHASE_ID3) &&
+              int(analyzer_t::PHASE_SYNC) == int(MP3_PHASE_SYNC) &&
+              int(analyzer_t::PHASE_VBR) == int(MP3_PHASE_VBR) &&
+              int(analyzer_t::PHASE_SCAN) == int(MP3_PHASE_SCAN),
+              "analyzer phases must match mp3_phase_t");
+
+struct session_t {
+    mp3_host_api_t host;        ///< parallel_for — точный подсчёт участками
+    analyzer_t analyzer;
+    uint64_t phase_us[MP3_PHASE_COUNT];     ///< Время фаз последнего run
+
+    // Анализ по шагам: чтение, выданное session_pending
+    request_t request;
+    uint8_t step_phase;         ///< Фаза, запросившая чтение
+    uint64_t step_started;      ///< clock_us выдачи запроса
+
+    // Промежуточные результаты (mp3_analyze_options_t::progress)
+    mp3_progress_fn progress;
+    void* progress_ctx;
+    uint64_t progress_bytes;    ///< Байт разобрано с начала анализа
+    uint64_t progress_next;     ///< Следующая оценка — не раньше этого progress_bytes
+
+    uint8_t scratch[MP3_NATIVE_SCRATCH_SIZE];
+};
+
+/**
+ * @brief Прогнать анализатор до конца, читая через host.read_at
+ *
+ * Цикл session_step без ограничения бюджета. Если у хоста есть parallel_for,
+ * точный подсчёт от MP3_NATIVE_PARALLEL_MIN_BYTES идёт участками на потоках хоста.
+ */
+mp3_result_t session_run(
+    session_t* session,
+    const mp3_analyze_options_t* options,
+    mp3_audio_info_t* out_info
+);
+
+/**
+ * @brief Продвинуть анализ, начатый session_begin, читая через host.read_at
+ *
+ * Читает, пока прочитано меньше budget_bytes (хотя бы одно окно).
+ * Если у хоста есть clock_us, время каждого чтения с разбором относится
+ * к фазе, запросившей данные. Оценки для progress — между окнами.
+ *
+ * @return true — анализ закончен (итог — session_finish)
+ */
+bool session_step(session_t* session, uint32_t budget_bytes);
+
+/**
+ * @brief Начать анализ по шагам: ввод-вывод делает вызывающий
+ *
+ * session_pending() говорит, какой диапазон прочитать в scratch сессии,
+ * session_feed() отдаёт результат и продолжает разбор, session_finish() —
+ * итог. Так прокладка ведёт асинхронный анализ (read_submit хоста).
+ * parallel_for в этом режиме не используется.
+ */
+void session_begin(session_t* session, const mp3_analyze_options_t* options);
+
+/**
+ * @brief Следующее чтение; false — анализ закончен
+ *
+ * Запрос уже урезан до scratch и размера источника и не бывает пустым.
+ */
+bool session_pending(session_t* session, request_t* out_req);
+
+/**
+ * @brief Результат чтения по последнему session_pending (данные — в scratch)
+ *
+ * Время от session_pending до session_feed, включая ожидание чтения,
+ * относится к фазе, запросившей данные.
+ */
+void session_feed(session_t* session, mp3_result_t read_result, size_t len);
+
+/// Итог анализа по шагам; при успехе он же уходит в progress (MP3_PROGRESS_FINAL)
+mp3_result_t session_finish(session_t* session, mp3_audio_info_t* out_info);
+
+/// Промежуточный результат анализа по шагам (analyzer_t::progress)
+mp3_result_t session_progress(const session_t* session, mp3_audio_info_t* out_info);
+
+/**
+ * @brief Счётчики разбора и время фаз последнего session_run
+ *
+ * Поля ввода-вывода out_stats не трогает — их ведёт прокладка.
+ */
+void session_stats(const session_t* session, mp3_session_stats_t* out_stats);
+
+/**
+ * @brief Точность длительности последнего session_run
+ */
+mp3_result_t session_estimate(const session_t* session, mp3_duration_estimate_t* out);
+
+/**
+ * @brief Разобрать источник, целиком лежащий в памяти
+ *
+ * Анализатор получает окна прямо из data: ни callback'ов, ни копий,
+ * ни аллокаций (состояние — на стеке).
+ */
+mp3_result_t analyze_buffer(const uint8_t* data, size_t len, mp3_audio_info_t* out_info);
+
+} // namespace mp3_native
@@ -0,0 +1,174 @@
+/**
+ * @file mp3_sync_scan.cpp
+ * @brief Поиск кандидатов sync-слова MPEG (0xFFE) — scalar и SIMD
+ *
+ * Кандидат — позиция i, где p[i] == 0xFF и (p[i + 1] & 0xE0) == 0xE0.
+ * Векторные версии сравнивают сразу 16/32 пары байт (p[i], p[i + 1])
+ * и по маске находят первую подходящую; хвост добирает scalar.
+ *
+ * Выбор реализации:
+ *  - x86: SSE2 есть всегда, AVX2 — по cpuid во время выполнения;
+ *  - ARM: NEON на этапе компиляции (__ARM_NEON);
+ *  - MP3_NATIVE_NO_SIMD — только scalar.
+ */
+
+#include "mp3_native.h"
+
+#if !defined(MP3_NATIVE_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__SSE2__) && defined(__GNUC__)
+    #define MP3_SYNC_X86 1
+    #include <immintrin.h>
+#elif !defined(MP3_NATIVE_NO_SIMD) && defined(__ARM_NEON)
+    #define MP3_SYNC_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace mp3_native {
+
+namespace {
+
+using find_sync_fn = size_t (*)(const uint8_t* p, size_t len);
+
+inline bool is_sync(const uint8_t* p) {
+    return p[0] == 0xFF && (p[1] & 0xE0) == 0xE0;
+}
+
+/// Дорезать хвост scalar-проходом с позиции i
+inline size_t scalar_from(const uint8_t* p, size_t len, size_t i) {
+    for (; i + 1 < len; ++i) {
+        if (is_sync(p + i)) {
+            return i;
+        }
+    }
+    return len;
+}
+
+#if defined(MP3_SYNC_X86)
+
+size_t find_sync_sse2(const uint8_t* p, size_t len) {
+    const __m128i ff = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i e0 = _mm_set1_epi8(static_cast<char>(0xE0));
+
+    size_t i = 0;
+    // Нужны 16 байт с i и 16 байт с i + 1
+    for (; i + 17 <= len; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 1));
+        const __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(a, ff),
+                                          _mm_cmpeq_epi8(_mm_and_si128(b, e0), e0));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) {
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+    return scalar_from(p, len, i);
+}
+
+__attribute__((target("avx2")))
+size_t find_sync_avx2(const uint8_t* p, size_t len) {
+    const __m256i ff = _mm256_set1_epi8(static_cast<char>(0xFF));
+    const __m256i e0 = _mm256_set1_epi8(static_cast<char>(0xE0));
+
+    size_t i = 0;
+    for (; i + 33 <= len; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 1));
+        const __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(a, ff),
+                                             _mm256_cmpeq_epi8(_mm256_and_si256(b, e0), e0));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) {
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+    return scalar_from(p, len, i);
+}
+
+bool has_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // MP3_SYNC_X86
+
+#if defined(MP3_SYNC_NEON)
+
+size_t find_sync_neon(const uint8_t* p, size_t len) {
+    const uint8x16_t ff = vdupq_n_u8(0xFF);
+    const uint8x16_t e0 = vdupq_n_u8(0xE0);
+
+    size_t i = 0;
+    for (; i + 17 <= len; i += 16) {
+        const uint8x16_t a = vld1q_u8(p + i);
+        const uint8x16_t b = vld1q_u8(p + i + 1);
+        const uint8x16_t hit = vandq_u8(vceqq_u8(a, ff), vceqq_u8(vandq_u8(b, e0), e0));
+        // 128 -> 64 бита: по 4 бита на байт, номер байта = ctz / 4
+        const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(hit), 4);
+        const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+        if (mask) {
+            return i + static_cast<size_t>(__builtin_ctzll(mask) >> 2);
+        }
+    }
+    return scalar_from(p, len, i);
+}
+
+#endif // MP3_SYNC_NEON
+
+find_sync_fn impl_fn(uint8_t impl) {
+    switch (impl) {
+#if defined(MP3_SYNC_X86)
+        case SYNC_SSE2: return find_sync_sse2;
+        case SYNC_AVX2: return has_avx2() ? find_sync_avx2 : nullptr;
+#endif
+#if defined(MP3_SYNC_NEON)
+        case SYNC_NEON: return find_sync_neon;
+#endif
+        case SYNC_SCALAR: return find_sync_scalar;
+        default:          return nullptr;
+    }
+}
+
+uint8_t select_impl() {
+#if defined(MP3_SYNC_X86)
+    return has_avx2() ? SYNC_AVX2 : SYNC_SSE2;
+#elif defined(MP3_SYNC_NEON)
+    return SYNC_NEON;
+#else
+    return SYNC_SCALAR;
+#endif
+}
+
+} // namespace
+
+size_t find_sync_scalar(const uint8_t* p, size_t len) {
+    return scalar_from(p, len, 0);
+}
+
+uint8_t sync_impl() {
+    static const uint8_t selected = select_impl();
+    return selected;
+}
+
+bool sync_impl_available(uint8_t impl) {
+    return impl_fn(impl) != nullptr;
+}
+
+const char* sync_impl_name(uint8_t impl) {
+    switch (impl) {
+        case SYNC_SCALAR: return "scalar";
+        case SYNC_SSE2:   return "sse2";
+        case SYNC_AVX2:   return "avx2";
+        case SYNC_NEON:   return "neon";
+        default:          return "unknown";
+    }
+}
+
+size_t find_sync_with(uint8_t impl, const uint8_t* p, size_t len) {
+    const find_sync_fn fn = impl_fn(impl);
+    return fn ? fn(p, len) : find_sync_scalar(p, len);
+}
+
+size_t find_sync(const uint8_t* p, size_t len) {
+    static const find_sync_fn selected = impl_fn(sync_impl());
+    return selected(p, len);
+}
+
+} // namespace mp3_native